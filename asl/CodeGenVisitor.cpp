@@ -38,6 +38,7 @@
 
 #include <string>
 #include <cstddef>    // std::size_t
+#include <utility>    // std::swap
 
 // uncomment the following line to enable debugging messages with DEBUG*
 // #define DEBUG_BUILD
@@ -45,6 +46,10 @@
 
 // using namespace std;
 
+// whole-array assignments up to this number of elements are copied
+// element by element; larger arrays are copied with a loop
+static const int MAX_UNROLLED_ARRAY_COPY = 16;
+
 
 // Constructor
 CodeGenVisitor::CodeGenVisitor(TypesMgr       & Types,
@@ -65,8 +70,8 @@ antlrcpp::Any CodeGenVisitor::visitProgram(AslParser::ProgramContext *ctx) {
   Symbols.pushThisScope(sc);
 
   for (auto ctxFunc : ctx->function()) {
-    subroutine subr = visit(ctxFunc);
-    my_code.add_subroutine(subr);
+    subroutine subr = take<subroutine>(visit(ctxFunc));
+    my_code.add_subroutine(std::move(subr));
   }
 
   Symbols.popScope();
@@ -81,30 +86,31 @@ antlrcpp::Any CodeGenVisitor::visitFunction(AslParser::FunctionContext *ctx) {
   SymTable::ScopeId sc = getScopeDecor(ctx);
   Symbols.pushThisScope(sc);
   subroutine subr(ctx->ID()->getText());
-  codeCounters.reset();
+  codeCounters = counters();
 
   // Return value (true if exists)
   if (visit(ctx->ret()))
     subr.add_param("_result");
 
   // Parameters
-  std::vector<std::string> && params = visit(ctx->parameters());
+  std::vector<std::string> && params = take<std::vector<std::string>>(visit(ctx->parameters()));
   for (auto & param : params)
     subr.add_param(param);
 
   // Declarations
-  std::vector<var> && lvars = visit(ctx->declarations());
+  std::vector<var> && lvars = take<std::vector<var>>(visit(ctx->declarations()));
   for (auto & onevar : lvars)
     subr.add_var(onevar);
 
   // Statements
-  instructionList && code = visit(ctx->statements());
+  instructionList && code = take<instructionList>(visit(ctx->statements()));
 
   // Hidden return on void functions
   if (Types.isVoidFunction(Symbols.getCurrentFunctionTy()))
-    code = code || instruction(instruction::RETURN());
+    code.append(instruction::RETURN());
 
-  subr.set_instructions(code);
+  subr.set_instructions(std::move(code));
+  subr.finalize();
   Symbols.popScope();
 
   DEBUG_EXIT();
@@ -138,7 +144,7 @@ antlrcpp::Any CodeGenVisitor::visitDeclarations(AslParser::DeclarationsContext *
   std::vector<var> lvars;
 
   for (auto & varDeclCtx : ctx->variable_decl()) {
-    std::vector<var> listvars = visit(varDeclCtx);
+    std::vector<var> listvars = take<std::vector<var>>(visit(varDeclCtx));
     for (auto & onevar : listvars)
       lvars.push_back(onevar);
   }
@@ -169,8 +175,8 @@ antlrcpp::Any CodeGenVisitor::visitStatements(AslParser::StatementsContext *ctx)
   instructionList code;
 
   for (auto stCtx : ctx->statement()) {
-    instructionList && codeS = visit(stCtx);
-    code = code || codeS;
+    instructionList && codeS = take<instructionList>(visit(stCtx));
+    code.append(std::move(codeS));
   }
 
   DEBUG_EXIT();
@@ -182,8 +188,8 @@ antlrcpp::Any CodeGenVisitor::visitProcCall(AslParser::ProcCallContext *ctx) {
 
   instructionList code;
 
-  CodeAttribs    &&   codAts = visit(ctx->ident());
-  std::string           name = codAts.addr;
+  CodeAttribs    &&   codAts = take<CodeAttribs>(visit(ctx->ident()));
+  std::string           name = codAts.addr.get_name();
   TypesMgr::TypeId      type = Symbols.getType(name);
 
   // Reserve space for _result
@@ -193,8 +199,8 @@ antlrcpp::Any CodeGenVisitor::visitProcCall(AslParser::ProcCallContext *ctx) {
   // Add parameters
   for (unsigned int i = 0; i < ctx->expr().size(); ++i){
 
-    CodeAttribs &&  codAts2 = visit(ctx->expr(i));
-    std::string       addr2 = codAts2.addr;
+    CodeAttribs &&  codAts2 = take<CodeAttribs>(visit(ctx->expr(i)));
+    operand           addr2 = codAts2.addr;
     instructionList & code2 = codAts2.code;
     TypesMgr::TypeId type2 = getTypeDecor(ctx->expr(i));
 
@@ -202,79 +208,84 @@ antlrcpp::Any CodeGenVisitor::visitProcCall(AslParser::ProcCallContext *ctx) {
 
     // Orig float, int found
     if (Types.isIntegerTy(type2) and Types.isFloatTy(type2_orig)){
-      std::string temp = "%"+codeCounters.newTEMP();
-      code = code || code2 || instruction::FLOAT(temp, addr2)
-             || instruction::PUSH(temp);
+      operand temp = codeCounters.newTEMP();
+      code.append(std::move(code2) || instruction::FLOAT(temp, addr2)
+                  || instruction::PUSH(temp));
     }
 
-    // Array
+    // Array (a parameter already holds the address of the array)
     else if (Types.isArrayTy(type2_orig)){
-      std::string temp = "%"+codeCounters.newTEMP();
-      code = code || code2 || instruction::ALOAD(temp, addr2)
-             || instruction::PUSH(temp);
+      operand temp = codeCounters.newTEMP();
+      if (Symbols.isParameterClass(addr2.get_name()))
+        code.append(std::move(code2) || instruction::LOAD(temp, addr2)
+                    || instruction::PUSH(temp));
+      else
+        code.append(std::move(code2) || instruction::ALOAD(temp, addr2)
+                    || instruction::PUSH(temp));
     }
 
     else
-      code = code || code2 || instruction::PUSH(addr2);
+      code.append(std::move(code2) || instruction::PUSH(addr2));
   }
 
-  code = code || instruction::CALL(name);
+  code.append(instruction::CALL(name));
 
   // Remove parameters
   for(unsigned int i = 0; i < ctx->expr().size(); ++i)
-    code = code || instruction::POP();
+    code.append(instruction::POP());
 
 
-  std::string addr3 = "";
+  operand addr3;
   if (not Types.isVoidFunction(type)){
-    addr3 = "%"+codeCounters.newTEMP();
-    code = code || instruction::POP(addr3);
+    addr3 = codeCounters.newTEMP();
+    code.append(instruction::POP(addr3));
   }
 
-  CodeAttribs codAts3(addr3, "", code);
+  CodeAttribs codAts3(addr3, "", std::move(code));
 
   DEBUG_EXIT();
   return codAts3;
 }
 
+// Only the code the context needs is generated:
+//   - value:      addr = *(@base + offset), offs empty
+//   - left value: addr = @base, offs = offset (stored with XLOAD)
 antlrcpp::Any CodeGenVisitor::visitArrayAccess(AslParser::ArrayAccessContext *ctx){
   DEBUG_ENTER();
 
+  // the index is a value, even in a left value
+  bool leftValue = leftValueAccess;
+  leftValueAccess = false;
+
   // If Parameter -> *name = @base_array
   // If Var       ->  name = @base_array
-  CodeAttribs &&   codAts1 = visit(ctx->ident());
-  std::string         name = codAts1.addr;
+  CodeAttribs &&   codAts1 = take<CodeAttribs>(visit(ctx->ident()));
+  operand             name = codAts1.addr;
   // addr_base = @base
-  std::string    addr_base = name;
+  operand        addr_base = name;
 
-  CodeAttribs && codAts2 = visit(ctx->expr());
+  CodeAttribs && codAts2 = take<CodeAttribs>(visit(ctx->expr()));
   // offs = offset
-  std::string      offs = codAts2.addr;
-  instructionList   code = codAts2.code;
-
-  // addr_element = @base + offset
-  std::string addr_element = "%"+codeCounters.newTEMP();
-
-  // content = *(@base + offset)
-  std::string content = "%"+codeCounters.newTEMP();
+  operand          offs = codAts2.addr;
+  instructionList & code = codAts2.code;
 
   // Parameter -> Load @base
-  if (Symbols.isParameterClass(name)){
-    addr_base = "%"+codeCounters.newTEMP();
-    code = code || instruction::LOAD(addr_base, name);
+  if (Symbols.isParameterClass(name.get_name())){
+    addr_base = codeCounters.newTEMP();
+    code.append(instruction::LOAD(addr_base, name));
   }
 
-  code = code || instruction::LOADX(content, addr_base, offs);
-
-  if (Symbols.isParameterClass(name))
-    code = code || instruction::ADD(addr_element, addr_base, offs);
+  if (leftValue) {
+    CodeAttribs codAts(addr_base, offs, std::move(code));
+    DEBUG_EXIT();
+    return codAts;
+  }
 
-  else
-    code = code || instruction::ALOAD(addr_element, name)
-           || instruction::ADD(addr_element, addr_element, offs);
+  // content = *(@base + offset)
+  operand content = codeCounters.newTEMP();
+  code.append(instruction::LOADX(content, addr_base, offs));
 
-  // addr = valor, offs = @base + offset, code AS IS
-  CodeAttribs codAts(content, addr_element, code);
+  CodeAttribs codAts(content, "", std::move(code));
 
   DEBUG_EXIT();
   return codAts;
@@ -283,7 +294,7 @@ antlrcpp::Any CodeGenVisitor::visitArrayAccess(AslParser::ArrayAccessContext *ct
 /*antlrcpp::Any CodeGenVisitor::visitControlExpr(AslParser::ControlExprContext *ctx) {
   DEBUG_ENTER();
 
-  CodeAttribs codAts = visit(ctx->expr());
+  CodeAttribs codAts = take<CodeAttribs>(visit(ctx->expr()));
 
   DEBUG_EXIT();
   return codAts;
@@ -294,50 +305,72 @@ antlrcpp::Any CodeGenVisitor::visitAssignStmt(AslParser::AssignStmtContext *ctx)
 
   instructionList code;
 
-  CodeAttribs     codAts1 = visit(ctx->left_expr());
-  std::string       addr1 = codAts1.addr;
-  std::string       offs1 = codAts1.offs;
-  instructionList   code1 = codAts1.code;
+  CodeAttribs     codAts1 = take<CodeAttribs>(visit(ctx->left_expr()));
+  operand           addr1 = codAts1.addr;
+  operand           offs1 = codAts1.offs;
+  instructionList & code1 = codAts1.code;
   TypesMgr::TypeId  type1 = getTypeDecor(ctx->left_expr());
 
-  CodeAttribs     codAts2 = visit(ctx->expr());
-  std::string       addr2 = codAts2.addr;
-  std::string       offs2 = codAts2.offs;
-  instructionList   code2 = codAts2.code;
+  CodeAttribs     codAts2 = take<CodeAttribs>(visit(ctx->expr()));
+  operand           addr2 = codAts2.addr;
+  instructionList & code2 = codAts2.code;
   TypesMgr::TypeId  type2 = getTypeDecor(ctx->expr());
 
 
-  if (offs1 == "" and Types.isArrayTy(type1) and Types.isArrayTy(type2)){
-    std::string temp1 = "%"+codeCounters.newTEMP();
-    std::string loop_iterator = "%"+codeCounters.newTEMP();
-    std::string array_left, array_right;
+  if (offs1.empty() and Types.isArrayTy(type1) and Types.isArrayTy(type2)){
+    operand temp1 = codeCounters.newTEMP();
+    operand loop_iterator = codeCounters.newTEMP();
+    operand array_left, array_right;
     array_left = addr1;
     array_right = addr2;
     int arraySize = Types.getArraySize(type1);
-    code = code1 || code2;
+    code = std::move(code1) || std::move(code2);
 
-    if(Symbols.isParameterClass(addr1)){
-        array_left = "%"+codeCounters.newTEMP();
-        code = code || instruction::LOAD(array_left, addr1);
+    if(Symbols.isParameterClass(addr1.get_name())){
+        array_left = codeCounters.newTEMP();
+        code.append(instruction::LOAD(array_left, addr1));
     }
-    if(Symbols.isParameterClass(addr2)){
-        array_right = "%"+codeCounters.newTEMP();
-        code = code || instruction::LOAD(array_right, addr2);
+    if(Symbols.isParameterClass(addr2.get_name())){
+        array_right = codeCounters.newTEMP();
+        code.append(instruction::LOAD(array_right, addr2));
     }
-    for (int i = 0; i < arraySize; ++i){
+    if (arraySize <= MAX_UNROLLED_ARRAY_COPY) {
+      code.reserve(code.size() + 3*arraySize);
+      for (int i = 0; i < arraySize; ++i){
 
-      code = code || instruction::ILOAD(loop_iterator, std::to_string(i));
-      code = code || instruction::LOADX(temp1, array_right, loop_iterator)
-             || instruction::XLOAD(array_left, loop_iterator, temp1);
+        code.append(instruction::ILOAD(loop_iterator, operand::ICONST(i)));
+        code.append(instruction::LOADX(temp1, array_right, loop_iterator));
+        code.append(instruction::XLOAD(array_left, loop_iterator, temp1));
+      }
+    }
+    else {
+      operand temp_size = codeCounters.newTEMP();
+      operand temp_one  = codeCounters.newTEMP();
+      operand temp_cond = codeCounters.newTEMP();
+      int         label = codeCounters.newLabelWHILE();
+      operand labelStart = operand::LABEL("copyArray", label);
+      operand   labelEnd = operand::LABEL("endCopyArray", label);
+
+      code.append(instruction::ILOAD(loop_iterator, operand::ICONST(0)) ||
+                  instruction::ILOAD(temp_size, operand::ICONST(arraySize)) ||
+                  instruction::ILOAD(temp_one, operand::ICONST(1)) ||
+                  instruction::LABEL(labelStart) ||
+                  instruction::LT(temp_cond, loop_iterator, temp_size) ||
+                  instruction::FJUMP(temp_cond, labelEnd) ||
+                  instruction::LOADX(temp1, array_right, loop_iterator) ||
+                  instruction::XLOAD(array_left, loop_iterator, temp1) ||
+                  instruction::ADD(loop_iterator, loop_iterator, temp_one) ||
+                  instruction::UJUMP(labelStart) ||
+                  instruction::LABEL(labelEnd));
     }
   }
   // Identifier
-  else if (offs1 == "")
-    code = code1 || code2 || instruction::LOAD(addr1, addr2);
+  else if (offs1.empty())
+    code = std::move(code1) || std::move(code2) || instruction::LOAD(addr1, addr2);
 
   // Array
   else
-    code = code1 || code2 || instruction::CLOAD(offs1, addr2);
+    code = std::move(code1) || std::move(code2) || instruction::XLOAD(addr1, offs1, addr2);
 
   DEBUG_EXIT();
   return code;
@@ -348,30 +381,27 @@ antlrcpp::Any CodeGenVisitor::visitIfStmt(AslParser::IfStmtContext *ctx) {
 
   instructionList code;
 
-  CodeAttribs     && codAts1 = visit(ctx->expr());
-  std::string          addr1 = codAts1.addr;
-  instructionList &    code1 = codAts1.code;
-
-  instructionList      code2 = visit(ctx->statements(0));
+  // code1 jumps to labelFalse when the condition is false (the
+  // labels are needed before the statements)
+  bool         hasElse = ctx->statements().size() > 1;
+  int            label = codeCounters.newLabelIF();
+  operand   labelFalse = operand::LABEL(hasElse ? "else" : "endif", label);
+  operand     labelEnd = operand::LABEL("endif", label);
+  instructionList code1 = conditionCode(ctx->expr(), labelFalse, false);
 
-  std::string label = codeCounters.newLabelIF();
-  std::string labelEnd = "endif"+label;
+  instructionList code2 = take<instructionList>(visit(ctx->statements(0)));
 
   // Only IF
-  if (ctx->statements().size() < 2)
-    code = code1 || instruction::FJUMP(addr1, labelEnd) ||
-           code2 || instruction::LABEL(labelEnd);
+  if (not hasElse)
+    code = std::move(code1) || std::move(code2) || instruction::LABEL(labelEnd);
 
   // IF and ELSE
   else {
-    instructionList    code3 = visit(ctx->statements(1));
-
-    std::string labelElse = "else"+label;
+    instructionList    code3 = take<instructionList>(visit(ctx->statements(1)));
 
-    code = code1 || instruction::FJUMP(addr1, labelElse) ||
-           code2 || instruction::UJUMP(labelEnd)         ||
-                    instruction::LABEL(labelElse)        ||
-           code3 || instruction::LABEL(labelEnd);
+    code = std::move(code1) || std::move(code2) || instruction::UJUMP(labelEnd) ||
+                               instruction::LABEL(labelFalse)                   ||
+           std::move(code3) || instruction::LABEL(labelEnd);
   }
 
   DEBUG_EXIT();
@@ -381,11 +411,11 @@ antlrcpp::Any CodeGenVisitor::visitIfStmt(AslParser::IfStmtContext *ctx) {
 antlrcpp::Any CodeGenVisitor::visitProcStmt(AslParser::ProcStmtContext *ctx) {
   DEBUG_ENTER();
 
-  CodeAttribs  && codAts = visit(ctx->function_call());
+  CodeAttribs  && codAts = take<CodeAttribs>(visit(ctx->function_call()));
   instructionList & code = codAts.code;
 
   DEBUG_EXIT();
-  return code;
+  return std::move(code);
 }
 
 antlrcpp::Any CodeGenVisitor::visitWhileStmt(AslParser::WhileStmtContext *ctx) {
@@ -393,91 +423,202 @@ antlrcpp::Any CodeGenVisitor::visitWhileStmt(AslParser::WhileStmtContext *ctx) {
 
   instructionList code;
 
-  CodeAttribs && codAts1 = visit(ctx->expr());
-  std::string      addr1 = codAts1.addr;
-  instructionList  code1 = codAts1.code;
-
-  instructionList  code2 = visit(ctx->statements());
+  // the loop is rotated: the condition is tested once before entering
+  // it, and then at the end of the body, jumping back while it holds
+  //     cond; ifFalse goto E; label L; body; cond'; ifFalse goto L; label E
+  // so each iteration runs one jump instead of two
+  int            label = codeCounters.newLabelWHILE();
+  operand   labelStart = operand::LABEL("WhileStmt", label);
+  operand     labelEnd = operand::LABEL("endWhileStmt", label);
+  instructionList guard = conditionCode(ctx->expr(), labelEnd, false);
+  instructionList  body = take<instructionList>(visit(ctx->statements()));
+  instructionList  test = conditionCode(ctx->expr(), labelStart, true);
 
-  std::string      label = codeCounters.newLabelWHILE();
-  std::string labelStart = "WhileStmt"+label;
-  std::string   labelEnd = "endWhileStmt"+label;
-
-  code = instruction::LABEL(labelStart) || code1 || instruction::FJUMP(addr1, labelEnd) ||
-         code2 || instruction::UJUMP(labelStart) || instruction::LABEL(labelEnd);
+  code = std::move(guard) || instruction::LABEL(labelStart) || std::move(body) ||
+         std::move(test) || instruction::LABEL(labelEnd);
 
   DEBUG_EXIT();
   return code;
 }
 
+// Jumping code for the condition of an if/while: jumps to label when
+// the condition is false (or true, with jumpIfTrue), and falls through
+// otherwise. The right operand of and/or is skipped when the left one
+// decides the result.
+instructionList CodeGenVisitor::conditionCode(AslParser::ExprContext *ctx,
+                                              const operand & label, bool jumpIfTrue) {
+  if (auto paren = dynamic_cast<AslParser::ParenthesisContext *>(ctx))
+    return conditionCode(paren->expr(), label, jumpIfTrue);
+
+  auto unary = dynamic_cast<AslParser::UnaryContext *>(ctx);
+  if (unary and unary->op->getText() == "not")
+    return conditionCode(unary->expr(), label, not jumpIfTrue);
+
+  if (auto logical = dynamic_cast<AslParser::LogicalContext *>(ctx)) {
+    bool isAnd = logical->op->getText() == "and";
+    // and: false as soon as the left operand is false
+    // or:  true  as soon as the left operand is true
+    if (isAnd != jumpIfTrue)
+      return conditionCode(logical->expr(0), label, jumpIfTrue) ||
+             conditionCode(logical->expr(1), label, jumpIfTrue);
+    // otherwise the left operand may skip the jump
+    operand labelSkip = operand::LABEL("skipCond", codeCounters.newLabelIF());
+    return conditionCode(logical->expr(0), labelSkip, not jumpIfTrue) ||
+           conditionCode(logical->expr(1), label, jumpIfTrue) ||
+           instruction::LABEL(labelSkip);
+  }
+
+  if (auto relational = dynamic_cast<AslParser::RelationalContext *>(ctx))
+    return comparisonCode(relational, label, jumpIfTrue);
+
+  // any other boolean expression: its value
+  CodeAttribs && codAts = take<CodeAttribs>(visit(ctx));
+  instructionList & code = codAts.code;
+  operand addr = codAts.addr;
+  if (jumpIfTrue) {
+    operand temp = codeCounters.newTEMP();
+    code.append(instruction::NOT(temp, addr));
+    addr = temp;
+  }
+  code.append(instruction::FJUMP(addr, label));
+  return std::move(code);
+}
+
+// Comparison in a condition, computed so that ifFalse jumps to label
+// without a NOT: ">" and ">=" swap their operands, and a jump when the
+// comparison is true tests its complement ("a < b" true is "b <= a"
+// false). Only "!=" (and the complements of float comparisons, which
+// are not exact with NaNs) still need a NOT.
+instructionList CodeGenVisitor::comparisonCode(AslParser::RelationalContext *ctx,
+                                               const operand & label, bool jumpIfTrue) {
+  CodeAttribs     && codAt1 = take<CodeAttribs>(visit(ctx->expr(0)));
+  operand             addr1 = codAt1.addr;
+  instructionList &   code1 = codAt1.code;
+  TypesMgr::TypeId    type1 = getTypeDecor(ctx->expr(0));
+
+  CodeAttribs     && codAt2 = take<CodeAttribs>(visit(ctx->expr(1)));
+  operand             addr2 = codAt2.addr;
+  instructionList &   code2 = codAt2.code;
+  TypesMgr::TypeId    type2 = getTypeDecor(ctx->expr(1));
+
+  instructionList &&   code = std::move(code1) || std::move(code2);
+
+  bool isFloat = Types.isFloatTy(type1) or Types.isFloatTy(type2);
+  if (not Types.isFloatTy(type1) and Types.isFloatTy(type2)){
+    operand temp1 = codeCounters.newTEMP();
+    code.append(instruction::FLOAT(temp1, addr1));
+    addr1 = temp1;
+  }
+  else if (Types.isFloatTy(type1) and not Types.isFloatTy(type2)){
+    operand temp2 = codeCounters.newTEMP();
+    code.append(instruction::FLOAT(temp2, addr2));
+    addr2 = temp2;
+  }
+
+  std::string op = ctx->op->getText();
+  bool negate = jumpIfTrue;
+  if (negate and (not isFloat or op == "==" or op == "!=")) {
+    op = op == "==" ? "!=" : op == "!=" ? "==" : op == "<" ? ">=" :
+         op == "<=" ? ">"  : op == ">"  ? "<=" : "<";
+    negate = false;
+  }
+  if (op == "!=") {
+    op = "==";
+    negate = not negate;
+  }
+  // > and >= swap their operands, but floats keep the NOT of <= and <
+  // that visitRelational uses (they differ when an operand is a NaN)
+  if ((op == ">" or op == ">=") and isFloat) {
+    op = op == ">" ? "<=" : "<";
+    negate = not negate;
+  }
+  else if (op == ">" or op == ">=") {
+    std::swap(addr1, addr2);
+    op = op == ">" ? "<" : "<=";
+  }
+
+  operand temp = codeCounters.newTEMP();
+  if (op == "==")
+    code.append(isFloat ? instruction::FEQ(temp, addr1, addr2) : instruction::EQ(temp, addr1, addr2));
+  else if (op == "<")
+    code.append(isFloat ? instruction::FLT(temp, addr1, addr2) : instruction::LT(temp, addr1, addr2));
+  else
+    code.append(isFloat ? instruction::FLE(temp, addr1, addr2) : instruction::LE(temp, addr1, addr2));
+  if (negate)
+    code.append(instruction::NOT(temp, temp));
+  code.append(instruction::FJUMP(temp, label));
+
+  return std::move(code);
+}
+
 antlrcpp::Any CodeGenVisitor::visitReadStmt(AslParser::ReadStmtContext *ctx) {
   DEBUG_ENTER();
 
-  CodeAttribs     && codAts1 = visit(ctx->left_expr());
-  std::string          addr1 = codAts1.addr;
-  std::string          offs1 = codAts1.offs;
-  instructionList       code = codAts1.code;
+  CodeAttribs     && codAts1 = take<CodeAttribs>(visit(ctx->left_expr()));
+  operand              addr1 = codAts1.addr;
+  operand              offs1 = codAts1.offs;
+  instructionList &     code = codAts1.code;
   TypesMgr::TypeId      type = getTypeDecor(ctx->left_expr());
 
   if (Types.isIntegerTy(type) or Types.isBooleanTy(type)){
     // Identifier
-    if (offs1 == "")
-      code = code || instruction::READI(addr1);
+    if (offs1.empty())
+      code.append(instruction::READI(addr1));
 
     // Array
     else {
-      std::string temp = "%"+codeCounters.newTEMP();
-      code = code || instruction::READI(temp) || instruction::CLOAD(offs1, temp);
+      operand temp = codeCounters.newTEMP();
+      code.append(instruction::READI(temp) || instruction::XLOAD(addr1, offs1, temp));
     }
   }
 
   else if (Types.isFloatTy(type)){
     // Identifier
-    if (offs1 == "")
-      code = code || instruction::READF(addr1);
+    if (offs1.empty())
+      code.append(instruction::READF(addr1));
 
     // Array
     else {
-      std::string temp = "%"+codeCounters.newTEMP();
-      code = code || instruction::READF(temp) || instruction::CLOAD(offs1, temp);
+      operand temp = codeCounters.newTEMP();
+      code.append(instruction::READF(temp) || instruction::XLOAD(addr1, offs1, temp));
     }
   }
 
   else if (Types.isCharacterTy(type)){
     // Identifier
-    if (offs1 == "")
-      code = code || instruction::READC(addr1);
+    if (offs1.empty())
+      code.append(instruction::READC(addr1));
 
     // Array
     else {
-      std::string temp = "%"+codeCounters.newTEMP();
-      code = code || instruction::READC(temp) || instruction::CLOAD(offs1, temp);
+      operand temp = codeCounters.newTEMP();
+      code.append(instruction::READC(temp) || instruction::XLOAD(addr1, offs1, temp));
     }
   }
 
   DEBUG_EXIT();
-  return code;
+  return std::move(code);
 }
 
 antlrcpp::Any CodeGenVisitor::visitWriteExpr(AslParser::WriteExprContext *ctx) {
   DEBUG_ENTER();
 
-  CodeAttribs  && codAt = visit(ctx->expr());
-  std::string      addr = codAt.addr;
-  instructionList  code = codAt.code;
+  CodeAttribs  && codAt = take<CodeAttribs>(visit(ctx->expr()));
+  operand          addr = codAt.addr;
+  instructionList & code = codAt.code;
   TypesMgr::TypeId type = getTypeDecor(ctx->expr());
 
   if (Types.isIntegerTy(type) or Types.isBooleanTy(type))
-    code = code || instruction::WRITEI(addr);
+    code.append(instruction::WRITEI(addr));
 
   else if (Types.isFloatTy(type))
-    code = code || instruction::WRITEF(addr);
+    code.append(instruction::WRITEF(addr));
 
   else if (Types.isCharacterTy(type))
-    code = code || instruction::WRITEC(addr);
+    code.append(instruction::WRITEC(addr));
 
   DEBUG_EXIT();
-  return code;
+  return std::move(code);
 }
 
 antlrcpp::Any CodeGenVisitor::visitWriteString(AslParser::WriteStringContext *ctx) {
@@ -485,36 +626,10 @@ antlrcpp::Any CodeGenVisitor::visitWriteString(AslParser::WriteStringContext *ct
 
   instructionList code;
   std::string s = ctx->STRING()->getText();
-  std::string temp = "%"+codeCounters.newTEMP();
-
-  int i = 1;
-  while (i < int(s.size())-1) {
-    if (s[i] != '\\') {
-      code = code ||
-	      instruction::CHLOAD(temp, s.substr(i,1)) ||
-	      instruction::WRITEC(temp);
-      i += 1;
-    }
-    else {
-      assert(i < int(s.size())-2);
-      if (s[i+1] == 'n') {
-        code = code || instruction::WRITELN();
-        i += 2;
-      }
-      else if (s[i+1] == 't' or s[i+1] == '"' or s[i+1] == '\\') {
-        code = code ||
-          instruction::CHLOAD(temp, s.substr(i,2)) ||
-	        instruction::WRITEC(temp);
-        i += 2;
-      }
-      else {
-        code = code ||
-          instruction::CHLOAD(temp, s.substr(i,1)) ||
-	        instruction::WRITEC(temp);
-        i += 1;
-      }
-    }
-  }
+  operand temp = codeCounters.newTEMP();
+
+  // one "writes" per literal (lowered to writec/writeln for tvm)
+  code.append(instruction::WRITES(temp, operand::STRCONST(s.substr(1, s.size()-2))));
 
   DEBUG_EXIT();
   return code;
@@ -527,10 +642,10 @@ antlrcpp::Any CodeGenVisitor::visitReturnStmt(AslParser::ReturnStmtContext *ctx)
 
   // Non-Void Function
   if (ctx->expr() != nullptr){
-    CodeAttribs codAts = visit(ctx->expr());
-    std::string addr = codAts.addr;
-    code = codAts.code;
-    code = code || instruction::LOAD("_result", addr) || instruction::RETURN();
+    CodeAttribs codAts = take<CodeAttribs>(visit(ctx->expr()));
+    operand addr = codAts.addr;
+    code = std::move(codAts.code);
+    code.append(instruction::LOAD("_result", addr) || instruction::RETURN());
   }
 
   DEBUG_EXIT();
@@ -540,7 +655,8 @@ antlrcpp::Any CodeGenVisitor::visitReturnStmt(AslParser::ReturnStmtContext *ctx)
 antlrcpp::Any CodeGenVisitor::visitArrayAccessLeftValue(AslParser::ArrayAccessLeftValueContext *ctx) {
   DEBUG_ENTER();
 
-  CodeAttribs codAts = visit(ctx->array_access());
+  leftValueAccess = true;
+  CodeAttribs codAts = take<CodeAttribs>(visit(ctx->array_access()));
 
   DEBUG_EXIT();
   return codAts;
@@ -549,7 +665,7 @@ antlrcpp::Any CodeGenVisitor::visitArrayAccessLeftValue(AslParser::ArrayAccessLe
 antlrcpp::Any CodeGenVisitor::visitIdentifier(AslParser::IdentifierContext *ctx) {
   DEBUG_ENTER();
 
-  CodeAttribs codAts = visit(ctx->ident());
+  CodeAttribs codAts = take<CodeAttribs>(visit(ctx->ident()));
 
   DEBUG_EXIT();
   return codAts;
@@ -558,7 +674,7 @@ antlrcpp::Any CodeGenVisitor::visitIdentifier(AslParser::IdentifierContext *ctx)
 antlrcpp::Any CodeGenVisitor::visitParenthesis(AslParser::ParenthesisContext *ctx) {
   DEBUG_ENTER();
 
-  CodeAttribs codAts = visit(ctx->expr());
+  CodeAttribs codAts = take<CodeAttribs>(visit(ctx->expr()));
 
   DEBUG_EXIT();
   return codAts;
@@ -567,7 +683,7 @@ antlrcpp::Any CodeGenVisitor::visitParenthesis(AslParser::ParenthesisContext *ct
 antlrcpp::Any CodeGenVisitor::visitArrayAccessExpr(AslParser::ArrayAccessExprContext *ctx) {
   DEBUG_ENTER();
 
-  CodeAttribs codAts = visit(ctx->array_access());
+  CodeAttribs codAts = take<CodeAttribs>(visit(ctx->array_access()));
 
   DEBUG_EXIT();
   return codAts;
@@ -576,7 +692,7 @@ antlrcpp::Any CodeGenVisitor::visitArrayAccessExpr(AslParser::ArrayAccessExprCon
 antlrcpp::Any CodeGenVisitor::visitFunctionExpr(AslParser::FunctionExprContext *ctx) {
   DEBUG_ENTER();
 
-  CodeAttribs codAts = visit(ctx->function_call());
+  CodeAttribs codAts = take<CodeAttribs>(visit(ctx->function_call()));
 
   DEBUG_EXIT();
   return codAts;
@@ -585,30 +701,30 @@ antlrcpp::Any CodeGenVisitor::visitFunctionExpr(AslParser::FunctionExprContext *
 antlrcpp::Any CodeGenVisitor::visitUnary(AslParser::UnaryContext *ctx) {
   DEBUG_ENTER();
 
-  CodeAttribs    &&  codAt = visit(ctx->expr());
-  std::string         addr = codAt.addr;
+  CodeAttribs    &&  codAt = take<CodeAttribs>(visit(ctx->expr()));
+  operand             addr = codAt.addr;
   instructionList &   code = codAt.code;
   TypesMgr::TypeId    type = getTypeDecor(ctx->expr());
 
-  std::string temp;
+  operand temp;
 
   if (ctx->op->getText() == "not") {
-    temp = "%"+codeCounters.newTEMP();
-    code = code || instruction::NOT(temp, addr);
+    temp = codeCounters.newTEMP();
+    code.append(instruction::NOT(temp, addr));
   }
 
   else if (ctx->op->getText() == "+")
     temp = addr;
 
   else if (ctx->op->getText() == "-") {
-    temp = "%"+codeCounters.newTEMP();
+    temp = codeCounters.newTEMP();
     if (Types.isFloatTy(type))
-      code = code || instruction::FNEG(temp, addr);
+      code.append(instruction::FNEG(temp, addr));
     else
-      code = code || instruction::NEG(temp, addr);
+      code.append(instruction::NEG(temp, addr));
   }
 
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
 
   DEBUG_EXIT();
   return codAts;
@@ -617,70 +733,70 @@ antlrcpp::Any CodeGenVisitor::visitUnary(AslParser::UnaryContext *ctx) {
 antlrcpp::Any CodeGenVisitor::visitArithmetic(AslParser::ArithmeticContext *ctx) {
   DEBUG_ENTER();
 
-  CodeAttribs     && codAt1 = visit(ctx->expr(0));
-  std::string         addr1 = codAt1.addr;
+  CodeAttribs     && codAt1 = take<CodeAttribs>(visit(ctx->expr(0)));
+  operand             addr1 = codAt1.addr;
   instructionList &   code1 = codAt1.code;
   TypesMgr::TypeId    type1 = getTypeDecor(ctx->expr(0));
 
-  CodeAttribs     && codAt2 = visit(ctx->expr(1));
-  std::string         addr2 = codAt2.addr;
+  CodeAttribs     && codAt2 = take<CodeAttribs>(visit(ctx->expr(1)));
+  operand             addr2 = codAt2.addr;
   instructionList &   code2 = codAt2.code;
   TypesMgr::TypeId    type2 = getTypeDecor(ctx->expr(1));
 
-  instructionList &&   code = code1 || code2;
+  instructionList &&   code = std::move(code1) || std::move(code2);
 
-  std::string temp = "%"+codeCounters.newTEMP();
+  operand temp = codeCounters.newTEMP();
 
   // TODO: can we delete temp1 and temp2?
   if (Types.isIntegerTy(type1) and Types.isFloatTy(type2)){
-    std::string temp1 = "%"+codeCounters.newTEMP();
-    code = code || instruction::FLOAT(temp1, addr1);
+    operand temp1 = codeCounters.newTEMP();
+    code.append(instruction::FLOAT(temp1, addr1));
     addr1 = temp1;
   }
 
   else if (Types.isFloatTy(type1) and Types.isIntegerTy(type2)){
-    std::string temp2 = "%"+codeCounters.newTEMP();
-    code = code || instruction::FLOAT(temp2, addr2);
+    operand temp2 = codeCounters.newTEMP();
+    code.append(instruction::FLOAT(temp2, addr2));
     addr2 = temp2;
   }
 
   if (Types.isFloatTy(type1) or Types.isFloatTy(type2)){
     if (ctx->op->getText() == "*")
-      code = code || instruction::FMUL(temp, addr1, addr2);
+      code.append(instruction::FMUL(temp, addr1, addr2));
 
     else if (ctx->op->getText() == "/")
-      code = code || instruction::FDIV(temp, addr1, addr2);
+      code.append(instruction::FDIV(temp, addr1, addr2));
 
     else if (ctx->op->getText() == "+")
-      code = code || instruction::FADD(temp, addr1, addr2);
+      code.append(instruction::FADD(temp, addr1, addr2));
 
     else if (ctx->op->getText() == "-")
-      code = code || instruction::FSUB(temp, addr1, addr2);
+      code.append(instruction::FSUB(temp, addr1, addr2));
   }
 
   else {
     if (ctx->op->getText() == "*")
-      code = code || instruction::MUL(temp, addr1, addr2);
+      code.append(instruction::MUL(temp, addr1, addr2));
 
     else if (ctx->op->getText() == "/")
-      code = code || instruction::DIV(temp, addr1, addr2);
+      code.append(instruction::DIV(temp, addr1, addr2));
 
     else if (ctx->op->getText() == "%"){
-      std::string temp1 = "%"+codeCounters.newTEMP();
-      std::string temp2 = "%"+codeCounters.newTEMP();
-      code = code || instruction::DIV(temp1, addr1, addr2);
-      code = code || instruction::MUL(temp2, temp1, addr2);
-      code = code || instruction::SUB(temp, addr1, temp2);
+      operand temp1 = codeCounters.newTEMP();
+      operand temp2 = codeCounters.newTEMP();
+      code.append(instruction::DIV(temp1, addr1, addr2));
+      code.append(instruction::MUL(temp2, temp1, addr2));
+      code.append(instruction::SUB(temp, addr1, temp2));
     }
 
     else if (ctx->op->getText() == "+")
-      code = code || instruction::ADD(temp, addr1, addr2);
+      code.append(instruction::ADD(temp, addr1, addr2));
 
     else if (ctx->op->getText() == "-")
-      code = code || instruction::SUB(temp, addr1, addr2);
+      code.append(instruction::SUB(temp, addr1, addr2));
   }
 
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
 
   DEBUG_EXIT();
   return codAts;
@@ -689,82 +805,82 @@ antlrcpp::Any CodeGenVisitor::visitArithmetic(AslParser::ArithmeticContext *ctx)
 antlrcpp::Any CodeGenVisitor::visitRelational(AslParser::RelationalContext *ctx) {
   DEBUG_ENTER();
 
-  CodeAttribs     && codAt1 = visit(ctx->expr(0));
-  std::string         addr1 = codAt1.addr;
+  CodeAttribs     && codAt1 = take<CodeAttribs>(visit(ctx->expr(0)));
+  operand             addr1 = codAt1.addr;
   instructionList &   code1 = codAt1.code;
   TypesMgr::TypeId    type1 = getTypeDecor(ctx->expr(0));
 
-  CodeAttribs     && codAt2 = visit(ctx->expr(1));
-  std::string         addr2 = codAt2.addr;
+  CodeAttribs     && codAt2 = take<CodeAttribs>(visit(ctx->expr(1)));
+  operand             addr2 = codAt2.addr;
   instructionList &   code2 = codAt2.code;
   TypesMgr::TypeId    type2 = getTypeDecor(ctx->expr(1));
 
-  instructionList &&   code = code1 || code2;
+  instructionList &&   code = std::move(code1) || std::move(code2);
 
-  std::string temp = "%"+codeCounters.newTEMP();
+  operand temp = codeCounters.newTEMP();
 
   // TODO: can we delete temp1 and temp2?
   if (not Types.isFloatTy(type1) and Types.isFloatTy(type2)){
-    std::string temp1 = "%"+codeCounters.newTEMP();
-    code = code || instruction::FLOAT(temp1, addr1);
+    operand temp1 = codeCounters.newTEMP();
+    code.append(instruction::FLOAT(temp1, addr1));
     addr1 = temp1;
   }
 
   else if (Types.isFloatTy(type1) and not Types.isFloatTy(type2)){
-    std::string temp2 = "%"+codeCounters.newTEMP();
-    code = code || instruction::FLOAT(temp2, addr2);
+    operand temp2 = codeCounters.newTEMP();
+    code.append(instruction::FLOAT(temp2, addr2));
     addr2 = temp2;
   }
 
   if (Types.isFloatTy(type1) or Types.isFloatTy(type2)){
     if (ctx->op->getText() == "==")
-      code = code || instruction::FEQ(temp, addr1, addr2);
+      code.append(instruction::FEQ(temp, addr1, addr2));
 
     else if (ctx->op->getText() == "!=")
-      code = code || instruction::FEQ(temp, addr1, addr2) || instruction::NOT(temp, temp);
+      code.append(instruction::FEQ(temp, addr1, addr2) || instruction::NOT(temp, temp));
 
     else if (ctx->op->getText() == "<")
-      code = code || instruction::FLT(temp, addr1, addr2);
+      code.append(instruction::FLT(temp, addr1, addr2));
 
     else if (ctx->op->getText() == "<=")
-      code = code || instruction::FLE(temp, addr1, addr2);
+      code.append(instruction::FLE(temp, addr1, addr2));
 
     else if (ctx->op->getText() == ">")
-      code = code || instruction::FLE(temp, addr1, addr2) || instruction::NOT(temp, temp);
+      code.append(instruction::FLE(temp, addr1, addr2) || instruction::NOT(temp, temp));
 
     else if (ctx->op->getText() == ">=")
-      code = code || instruction::FLT(temp, addr1, addr2) || instruction::NOT(temp, temp);
+      code.append(instruction::FLT(temp, addr1, addr2) || instruction::NOT(temp, temp));
   }
 
   else if (Types.isBooleanTy(type1) and Types.isBooleanTy(type2)){
     if (ctx->op->getText() == "==")
-      code = code || instruction::EQ(temp, addr1, addr2);
+      code.append(instruction::EQ(temp, addr1, addr2));
 
     else if (ctx->op->getText() == "!=")
-      code = code || instruction::EQ(temp, addr1, addr2) || instruction::NOT(temp, temp);
+      code.append(instruction::EQ(temp, addr1, addr2) || instruction::NOT(temp, temp));
   }
 
   else {
     if (ctx->op->getText() == "==")
-      code = code || instruction::EQ(temp, addr1, addr2);
+      code.append(instruction::EQ(temp, addr1, addr2));
 
     else if (ctx->op->getText() == "!=")
-      code = code || instruction::EQ(temp, addr1, addr2) || instruction::NOT(temp, temp);
+      code.append(instruction::EQ(temp, addr1, addr2) || instruction::NOT(temp, temp));
 
     else if (ctx->op->getText() == "<")
-      code = code || instruction::LT(temp, addr1, addr2);
+      code.append(instruction::LT(temp, addr1, addr2));
 
     else if (ctx->op->getText() == "<=")
-      code = code || instruction::LE(temp, addr1, addr2);
+      code.append(instruction::LE(temp, addr1, addr2));
 
     else if (ctx->op->getText() == ">")
-      code = code || instruction::LE(temp, addr1, addr2) || instruction::NOT(temp, temp);
+      code.append(instruction::LE(temp, addr1, addr2) || instruction::NOT(temp, temp));
 
     else if (ctx->op->getText() == ">=")
-      code = code || instruction::LT(temp, addr1, addr2) || instruction::NOT(temp, temp);
+      code.append(instruction::LT(temp, addr1, addr2) || instruction::NOT(temp, temp));
   }
 
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
 
   DEBUG_EXIT();
   return codAts;
@@ -773,25 +889,25 @@ antlrcpp::Any CodeGenVisitor::visitRelational(AslParser::RelationalContext *ctx)
 antlrcpp::Any CodeGenVisitor::visitLogical(AslParser::LogicalContext *ctx) {
   DEBUG_ENTER();
 
-  CodeAttribs     && codAt1 = visit(ctx->expr(0));
-  std::string         addr1 = codAt1.addr;
+  CodeAttribs     && codAt1 = take<CodeAttribs>(visit(ctx->expr(0)));
+  operand             addr1 = codAt1.addr;
   instructionList &   code1 = codAt1.code;
 
-  CodeAttribs     && codAt2 = visit(ctx->expr(1));
-  std::string         addr2 = codAt2.addr;
+  CodeAttribs     && codAt2 = take<CodeAttribs>(visit(ctx->expr(1)));
+  operand             addr2 = codAt2.addr;
   instructionList &   code2 = codAt2.code;
 
-  instructionList &&   code = code1 || code2;
+  instructionList &&   code = std::move(code1) || std::move(code2);
 
-  std::string temp = "%"+codeCounters.newTEMP();
+  operand temp = codeCounters.newTEMP();
 
   if (ctx->op->getText() == "and")
-    code = code || instruction::AND(temp, addr1, addr2);
+    code.append(instruction::AND(temp, addr1, addr2));
 
   else if (ctx->op->getText() == "or")
-    code = code || instruction::OR(temp, addr1, addr2);
+    code.append(instruction::OR(temp, addr1, addr2));
 
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
 
   DEBUG_EXIT();
   return codAts;
@@ -801,29 +917,29 @@ antlrcpp::Any CodeGenVisitor::visitValue(AslParser::ValueContext *ctx) {
   DEBUG_ENTER();
 
   instructionList code;
-  std::string temp = "%"+codeCounters.newTEMP();
+  operand temp = codeCounters.newTEMP();
 
   if (ctx->INTVAL() != nullptr)
-    code = instruction::ILOAD(temp, ctx->getText());
+    code = instruction::ILOAD(temp, operand::ICONST(ctx->getText()));
 
   else if (ctx->BOOLVAL() != nullptr){
 
     std::string value = ctx->getText();
 
     if (value == "true" or value == "1")
-      code = instruction::ILOAD(temp, "1");
+      code = instruction::ILOAD(temp, operand::ICONST(1));
 
     else
-      code = instruction::ILOAD(temp, "0");
+      code = instruction::ILOAD(temp, operand::ICONST(0));
   }
 
   else if (ctx->FLOATVAL() != nullptr)
-    code = instruction::FLOAD(temp, ctx->getText());
+    code = instruction::FLOAD(temp, operand::FCONST(ctx->getText()));
 
   else if (ctx->CHARVAL() != nullptr)
-    code = instruction::CHLOAD(temp, ctx->getText().substr(1, ctx->getText().length()-2));
+    code = instruction::CHLOAD(temp, operand::CHCONST(ctx->getText().substr(1, ctx->getText().length()-2)));
 
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs codAts(temp, "", std::move(code));
 
   DEBUG_EXIT();
   return codAts;
@@ -832,7 +948,7 @@ antlrcpp::Any CodeGenVisitor::visitValue(AslParser::ValueContext *ctx) {
 antlrcpp::Any CodeGenVisitor::visitExprIdent(AslParser::ExprIdentContext *ctx) {
   DEBUG_ENTER();
 
-  CodeAttribs codAts = visit(ctx->ident());
+  CodeAttribs codAts = take<CodeAttribs>(visit(ctx->ident()));
 
   DEBUG_EXIT();
   return codAts;
@@ -860,14 +976,14 @@ TypesMgr::TypeId CodeGenVisitor::getTypeDecor(antlr4::ParserRuleContext *ctx) co
 
 // Constructors of the class CodeAttribs:
 //
-CodeGenVisitor::CodeAttribs::CodeAttribs(const std::string & addr,
-					 const std::string & offs,
+CodeGenVisitor::CodeAttribs::CodeAttribs(const operand & addr,
+					 const operand & offs,
 					 instructionList & code) :
   addr{addr}, offs{offs}, code{code} {
 }
 
-CodeGenVisitor::CodeAttribs::CodeAttribs(const std::string & addr,
-					 const std::string & offs,
+CodeGenVisitor::CodeAttribs::CodeAttribs(const operand & addr,
+					 const operand & offs,
 					 instructionList && code) :
-  addr{addr}, offs{offs}, code{code} {
+  addr{addr}, offs{offs}, code{std::move(code)} {
 }
@@ -38,6 +38,7 @@
 #include "../common/code.h"
 
 #include <string>
+#include <utility>    // std::move
 
 // using namespace std;
 
@@ -100,13 +101,31 @@ private:
   TypesMgr        & Types;
   SymTable        & Symbols;
   TreeDecoration  & Decorations;
+  // per-function codegen context: label and temporary counters of
+  // the function being generated (a fresh set for each function)
   counters          codeCounters;
+  // the array access being generated is a left value (set by
+  // visitArrayAccessLeftValue, and taken by visitArrayAccess)
+  bool              leftValueAccess = false;
+
+  // Take the result of a visit, moving it out of the antlrcpp::Any
+  // (converting the Any to T would deep copy it)
+  template <class T> static T take(antlrcpp::Any && result) { return std::move(result.as<T>()); }
 
   // Getters for the necessary tree node atributes:
   //   Scope and Type
   SymTable::ScopeId getScopeDecor (antlr4::ParserRuleContext *ctx) const;
   TypesMgr::TypeId  getTypeDecor  (antlr4::ParserRuleContext *ctx) const;
 
+  // Jumping code for the condition of an if/while: goes to label when
+  // the condition is false (or true, if jumpIfTrue), and falls through
+  // otherwise; and/or skip their right operand when the left one
+  // decides the result
+  instructionList conditionCode(AslParser::ExprContext *ctx,
+                                const operand & label, bool jumpIfTrue);
+  instructionList comparisonCode(AslParser::RelationalContext *ctx,
+                                 const operand & label, bool jumpIfTrue);
+
 
   //////////////////////////////////////////////////////////////////
   // Class CodeAttribs: is declared inside CodeGenVisitor as an
@@ -119,18 +138,18 @@ private:
 
   public:
     // Constructors
-    CodeAttribs(const std::string & addr,
-	        const std::string & offs,
+    CodeAttribs(const operand & addr,
+	        const operand & offs,
 		instructionList & code);
-    CodeAttribs(const std::string & addr,
-	        const std::string & offs,
+    CodeAttribs(const operand & addr,
+	        const operand & offs,
 		instructionList && code);
 
     // Attributes (publics):
     //   - the address that will hold the value of an expression
-    std::string addr;
+    operand addr;
     //   - the offset applied to the address (for array access)
-    std::string offs;
+    operand offs;
     //   - the three-address code associated to an statement/expression
     instructionList code;
 
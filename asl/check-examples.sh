@@ -60,3 +60,21 @@ echo "END   examples-initial/execution"
      rm -f tmp.t tmp.out
  done
  echo "END   examples-full/execution"
+
+echo ""
+echo "BEGIN examples-opt/execution"
+for f in ../examples/jp_opt_*.asl; do
+    echo $(basename "$f")
+    ./asl "$f" > tmp.t
+    ../tvm/tvm tmp.t < "${f/asl/in}" > tmp.out
+    diff tmp.out "${f/asl/out}"
+    rm -f tmp.t tmp.out
+done
+for f in ../examples/jpbasic_genc_*.asl ../examples/jp_genc_*.asl ../examples/jp_opt_*.asl; do
+    echo $(basename "$f") "(-O)"
+    ./asl -O "$f" > tmp.t
+    ../tvm/tvm tmp.t < "${f/asl/in}" > tmp.out
+    diff tmp.out "${f/asl/out}"
+    rm -f tmp.t tmp.out
+done
+echo "END   examples-opt/execution"
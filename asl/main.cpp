@@ -41,34 +41,55 @@
 #include "SymbolsVisitor.h"
 #include "TypeCheckVisitor.h"
 #include "../common/code.h"
+#include "../common/arena.h"
+#include "../common/optimizer.h"
 #include "CodeGenVisitor.h"
 
 #include <iostream>
 #include <fstream>    // ifstream
+#include <string>
 
 #include <cstdio>     // fopen
 #include <cstdlib>    // EXIT_FAILURE, EXIT_SUCCESS
+#include <utility>    // std::move
 
 // using namespace std;
 // using namespace antlr4;
 
 
 int main(int argc, const char* argv[]) {
-  // check the correct use of the program
-  if (argc > 2) {
-    std::cout << "Usage: ./main [<file>]" << std::endl;
+  // check the correct use of the program (option -O optimizes the
+  // generated code, -uN sets the factor its loops are unrolled by, -v
+  // reports the work of the optimizer, and -s keeps the "writes"
+  // instructions, for executors that implement them)
+  bool optimize = false, verbose = false, strings = false;
+  std::size_t unrollFactor = 4;
+  int arg = 1;
+  for (; arg < argc and argv[arg][0] == '-'; ++arg) {
+    std::string option = argv[arg];
+    if (option == "-O") optimize = true;
+    else if (option == "-v") verbose = true;
+    else if (option == "-s") strings = true;
+    else if (option.compare(0, 2, "-u") == 0 and option.size() > 2 and option.size() < 6 and
+             option.find_first_not_of("0123456789", 2) == std::string::npos)
+      unrollFactor = std::stoul(option.substr(2));
+    else break;
+  }
+  const char *file = arg < argc ? argv[arg] : nullptr;
+  if (arg + 1 < argc or (file and file[0] == '-')) {
+    std::cout << "Usage: ./main [-O] [-uN] [-v] [-s] [<file>]" << std::endl;
     return EXIT_FAILURE;
   }
-  if (argc == 2 and not std::fopen(argv[1], "r")) {
-    std::cout << "No such file: " << argv[1] << std::endl;
+  if (file and not std::fopen(file, "r")) {
+    std::cout << "No such file: " << file << std::endl;
     return EXIT_FAILURE;
   }
 
   // open input file (or std::cin) and create a character stream
   antlr4::ANTLRInputStream input;
-  if (argc == 2) {  // read from <file>
+  if (file) {       // read from <file>
     std::ifstream stream;
-    stream.open(argv[1]);
+    stream.open(file);
     input = antlr4::ANTLRInputStream(stream);
   }
   else {            // read fron std::cin
@@ -117,10 +138,26 @@ int main(int argc, const char* argv[]) {
     return EXIT_FAILURE;
   }
 
+  // instruction lists built during code generation are allocated in
+  // this arena, and released all together when main ends
+  arena codegenArena;
+  arena::scope useArena(codegenArena);
+
   // create a third visitor that will return the generated code
   // for each part of the tree, and will store it in 'mycode'
   CodeGenVisitor codegenerator(types, symbols, decorations);
-  code mycode = codegenerator.visit(tree);
+  code mycode = std::move(codegenerator.visit(tree).as<code>());
+
+  // tvm writes strings one char at a time (lowered before optimizing,
+  // so that the chars loaded are shared)
+  if (not strings) mycode.lower_strings();
+
+  // optimize the generated code, if asked to
+  if (optimize) {
+    optimizer opt(unrollFactor);
+    opt.optimize(mycode);
+    if (verbose) std::cerr << opt.dump_report();
+  }
 
   // print generated code as output
   std::cout << mycode.dump() << std::endl;
@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    arena - Bump allocator for code generation intermediates
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "arena.h"
+
+#include <cassert>
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'arena'
+
+thread_local arena * arena::currentArena = nullptr;
+
+/// constructor and destructor
+arena::arena(std::size_t chunkSize) :
+  chunkSize(chunkSize), next(nullptr), limit(nullptr),
+  numAllocations(0), numReused(0), bytesAllocated(0), bytesReserved(0) {
+  for (int c = 0; c < numClasses; ++c)
+    freeBlocks[c] = nullptr;
+}
+
+arena::~arena() {
+  for (char *c : chunks)
+    ::operator delete(c);
+  for (char *b : bigBlocks)
+    ::operator delete(b);
+}
+
+/// size class of a block of n bytes: blocks of class c have 16<<c bytes
+int arena::size_class(std::size_t n) {
+  int c = 0;
+  while ((std::size_t(16) << c) < n) ++c;
+  return c;
+}
+
+/// get n bytes with the given alignment
+void * arena::allocate(std::size_t n, std::size_t align) {
+  assert(align <= alignof(std::max_align_t));
+  (void)align;  // all blocks are aligned to max_align_t
+  ++numAllocations;
+  bytesAllocated += n;
+
+  int c = size_class(n);
+  std::size_t sz = std::size_t(16) << c;
+
+  // reuse a released block of the same class, if any
+  if (freeBlocks[c] != nullptr) {
+    void *p = freeBlocks[c];
+    freeBlocks[c] = *static_cast<void **>(p);
+    ++numReused;
+    return p;
+  }
+
+  // big blocks come directly from the heap (and go back to it when
+  // released), so they do not waste chunk space
+  if (sz > chunkSize / 4) {
+    char *b = static_cast<char *>(::operator new(sz));
+    bigBlocks.push_back(b);
+    bytesReserved += sz;
+    return b;
+  }
+
+  if (next == nullptr or next + sz > limit) {
+    next = static_cast<char *>(::operator new(chunkSize));
+    limit = next + chunkSize;
+    chunks.push_back(next);
+    bytesReserved += chunkSize;
+  }
+  void *p = next;
+  next += sz;
+  return p;
+}
+
+/// give back a block, to be reused by a later allocation of its class
+void arena::release(void *p, std::size_t n) {
+  if (p == nullptr) return;
+  int c = size_class(n);
+  if ((std::size_t(16) << c) > chunkSize / 4) {
+    for (std::size_t i = bigBlocks.size(); i-- > 0; )
+      if (bigBlocks[i] == p) {
+        bigBlocks[i] = bigBlocks.back();
+        bigBlocks.pop_back();
+        bytesReserved -= std::size_t(16) << c;
+        ::operator delete(p);
+        return;
+      }
+  }
+  *static_cast<void **>(p) = freeBlocks[c];
+  freeBlocks[c] = p;
+}
+
+/// statistics
+std::size_t arena::get_num_allocations() const { return numAllocations; }
+std::size_t arena::get_num_reused() const { return numReused; }
+std::size_t arena::get_bytes_allocated() const { return bytesAllocated; }
+std::size_t arena::get_bytes_reserved() const { return bytesReserved; }
+
+/// current arena of this thread
+arena * arena::current() { return currentArena; }
+
+arena::scope::scope(arena &a) : previous(currentArena) { currentArena = &a; }
+arena::scope::~scope() { currentArena = previous; }
@@ -0,0 +1,137 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    arena - Bump allocator for code generation intermediates
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <new>
+#include <type_traits>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class arena is a bump allocator: memory is taken from big chunks
+/// and only returned to the system in one shot, when the arena is
+/// destroyed. Blocks given back with release() are kept in per-size
+/// free lists and reused by later requests of the same size class
+/// (except big blocks, which are returned to the heap right away).
+/// Used for the (many, short lived) instruction lists built while
+/// generating code.
+
+class arena {
+public:
+  /// constructor (memory is reserved in chunks of the given size)
+  arena(std::size_t chunkSize = 1 << 20);
+  /// destructor: releases all the memory of the arena
+  ~arena();
+  /// an arena owns its chunks, so it can not be copied
+  arena(const arena &) = delete;
+  arena & operator=(const arena &) = delete;
+
+  /// get n bytes with the given alignment (at most that of max_align_t)
+  void * allocate(std::size_t n, std::size_t align);
+  /// give back a block of n bytes obtained with allocate
+  void release(void *p, std::size_t n);
+
+  /// statistics
+  std::size_t get_num_allocations() const;
+  std::size_t get_num_reused() const;
+  std::size_t get_bytes_allocated() const;
+  std::size_t get_bytes_reserved() const;
+
+  /// arena used by arenaAllocator in this thread (nullptr: plain heap)
+  static arena * current();
+
+  /// Class scope makes an arena the current one while it is alive
+  class scope {
+  public:
+    scope(arena &a);
+    ~scope();
+    scope(const scope &) = delete;
+    scope & operator=(const scope &) = delete;
+  private:
+    arena *previous;
+  };
+
+private:
+  /// blocks are rounded up to a power of two (size class), and the
+  /// ones bigger than a quarter of a chunk get a chunk of their own
+  static const int numClasses = 48;
+  static int size_class(std::size_t n);
+
+  std::size_t chunkSize;
+  /// chunks of memory, and free space in the last one
+  std::vector<char *> chunks;
+  char *next, *limit;
+  /// big blocks, allocated one by one
+  std::vector<char *> bigBlocks;
+  /// released blocks of each size class (linked through their first word)
+  void *freeBlocks[numClasses];
+  /// statistics
+  std::size_t numAllocations, numReused, bytesAllocated, bytesReserved;
+
+  static thread_local arena *currentArena;
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Class arenaAllocator is a standard allocator that takes memory
+/// from the arena that was current when it was created (or from the
+/// heap if there was none). Containers keep their allocator when
+/// moved or swapped, so memory is always returned to where it came from.
+
+template <class T>
+class arenaAllocator {
+public:
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  arenaAllocator() : owner(arena::current()) {}
+  template <class U>
+  arenaAllocator(const arenaAllocator<U> &other) : owner(other.get_arena()) {}
+
+  T * allocate(std::size_t n) {
+    if (owner) return static_cast<T *>(owner->allocate(n * sizeof(T), alignof(T)));
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+  void deallocate(T *p, std::size_t n) {
+    if (owner) owner->release(p, n * sizeof(T));
+    else ::operator delete(p);
+  }
+
+  arena * get_arena() const { return owner; }
+
+  template <class U>
+  bool operator==(const arenaAllocator<U> &other) const { return owner == other.get_arena(); }
+  template <class U>
+  bool operator!=(const arenaAllocator<U> &other) const { return owner != other.get_arena(); }
+
+private:
+  arena *owner;
+};
@@ -0,0 +1,180 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    branches - Jump threading, label merging and block ordering
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+
+#include "branches.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'branchSimplification'
+
+branchSimplification::branchSimplification() : count(0) {}
+
+std::size_t branchSimplification::run(subroutine &subr) {
+  count = 0;
+  instructionList code = subr.get_instructions();
+  thread_jumps(code);
+  order_blocks(code);
+  remove_jumps_and_labels(code);
+  subr.set_instructions(std::move(code));
+  subr.finalize();
+  return count;
+}
+
+/// jumps go to the end of the chains of labels and "goto"s
+void branchSimplification::thread_jumps(instructionList &code) {
+  controlFlowGraph cfg(code);
+
+  // block where a jump to b really goes on (-1 if b does some work)
+  auto step = [&](std::size_t b) -> int {
+    const basicBlock &blk = cfg.get_block(b);
+    std::size_t k = blk.get_label().empty() ? 0 : 1;
+    if (k == blk.instructions.size()) return blk.fallthrough;
+    if (k+1 == blk.instructions.size() and blk.instructions[k].oper == instruction::_UJUMP)
+      return cfg.get_block_of_label(blk.instructions[k].arg1);
+    return -1;
+  };
+
+  for (std::size_t b = 0; b < cfg.get_num_blocks(); ++b) {
+    instruction *t = cfg.get_block(b).get_terminator();
+    if (t == nullptr or (t->oper != instruction::_UJUMP and t->oper != instruction::_FJUMP))
+      continue;
+    operand &target = t->oper == instruction::_UJUMP ? t->arg1 : t->arg2;
+    int cur = cfg.get_block_of_label(target);
+    if (cur < 0) continue;
+    std::set<int> seen = {cur};
+    for (int next = step(cur); next >= 0 and seen.insert(next).second; next = step(cur)) {
+      if (cfg.get_block(next).get_label().empty()) break;
+      cur = next;
+    }
+    const basicBlock &dest = cfg.get_block(cur);
+    if (dest.get_label() != target) {
+      target = dest.get_label();
+      ++count;
+    }
+    std::size_t k = dest.get_label().empty() ? 0 : 1;
+    if (t->oper == instruction::_UJUMP and k+1 == dest.instructions.size() and
+        dest.instructions[k].oper == instruction::_RETURN) {
+      *t = instruction::RETURN();
+      ++count;
+    }
+  }
+  code = cfg.linearize();
+}
+
+/// lay out the blocks so that "goto"s fall through where they can
+void branchSimplification::order_blocks(instructionList &code) {
+  controlFlowGraph cfg(code);
+  std::size_t n = cfg.get_num_blocks();
+  std::vector<std::vector<std::size_t>> fallsIn(n);
+  for (std::size_t b = 0; b < n; ++b)
+    if (cfg.is_reachable(b) and cfg.get_block(b).fallthrough >= 0)
+      fallsIn[cfg.get_block(b).fallthrough].push_back(b);
+
+  std::vector<bool> placed(n, false);
+  // the target of the "goto" at the end of 'from' is placed after it,
+  // unless a block not placed yet falls through to it and is not in a
+  // shallower loop than 'from'
+  auto follows = [&](std::size_t from, std::size_t to) -> bool {
+    if (to == 0 or placed[to] or not cfg.is_reachable(to)) return false;
+    for (auto p : fallsIn[to])
+      if (not placed[p] and cfg.get_loop_depth(p) >= cfg.get_loop_depth(from)) return false;
+    return true;
+  };
+
+  std::vector<std::size_t> order;
+  std::size_t scan = 0;
+  for (int cur = 0; cur >= 0; ) {
+    placed[cur] = true;
+    order.push_back(cur);
+    const basicBlock &blk = cfg.get_block(cur);
+    const instruction *t = blk.get_terminator();
+    int next = -1;
+    if (blk.fallthrough >= 0 and not placed[blk.fallthrough])
+      next = blk.fallthrough;
+    else if (t != nullptr and t->oper == instruction::_UJUMP) {
+      int target = cfg.get_block_of_label(t->arg1);
+      if (target >= 0 and follows(cur, target)) next = target;
+    }
+    if (next < 0) {
+      // otherwise, the first block left in the original order
+      while (scan < n and (placed[scan] or not cfg.is_reachable(scan))) ++scan;
+      if (scan < n) next = scan;
+    }
+    cur = next;
+  }
+  code = cfg.linearize(order);
+}
+
+/// remove the jumps to the next instruction and the labels not used,
+/// and merge adjacent labels (until nothing changes)
+void branchSimplification::remove_jumps_and_labels(instructionList &code) {
+  auto target_of = [](instruction &i) -> operand * {
+    return i.oper == instruction::_UJUMP ? &i.arg1 : i.oper == instruction::_FJUMP ? &i.arg2 : nullptr;
+  };
+  for (bool changed = true; changed; ) {
+    changed = false;
+    std::map<operand, int> uses;
+    for (auto &i : code)
+      if (operand *lab = target_of(i)) ++uses[*lab];
+
+    instructionList out;
+    out.reserve(code.size());
+    std::map<operand, operand> merged;
+    for (std::size_t pc = 0; pc < code.size(); ++pc) {
+      instruction &i = code[pc];
+      bool removed = false;
+      if (operand *lab = target_of(i)) {
+        for (std::size_t k = pc+1; k < code.size() and code[k].oper == instruction::_LABEL; ++k)
+          removed = removed or code[k].arg1 == *lab;
+      }
+      else if (i.oper == instruction::_LABEL) {
+        removed = uses[i.arg1] == 0;
+        if (not removed and not out.empty() and out.back().oper == instruction::_LABEL) {
+          merged[i.arg1] = out.back().arg1;
+          removed = true;
+        }
+      }
+      if (removed) {
+        ++count;
+        changed = true;
+      }
+      else
+        out.append(i);
+    }
+    for (auto &i : out) {
+      operand *lab = target_of(i);
+      if (lab != nullptr and merged.count(*lab)) *lab = merged[*lab];
+    }
+    code = std::move(out);
+  }
+}
@@ -0,0 +1,65 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    branches - Jump threading, label merging and block ordering
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include "code.h"
+#include "cfg.h"
+
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class branchSimplification cleans up the jumps of a subroutine
+/// after the other passes:
+///   - jumps to a "goto" (or to labels falling through to it) jump to
+///     its target directly, and a "goto" to a "return" becomes one
+///   - blocks are laid out again: a block entered only by jumps is
+///     placed after the "goto" that leads to it (the one in the deepest
+///     loop, if others fall through to it), so that this path falls
+///     through; unreachable blocks are left out
+///   - jumps to the next instruction are removed, labels no jump uses
+///     are removed, and adjacent labels are merged into the first one
+
+class branchSimplification {
+public:
+  /// constructor
+  branchSimplification();
+
+  /// simplify the jumps of a subroutine, and return the number of
+  /// jumps and labels changed or removed
+  std::size_t run(subroutine &subr);
+
+private:
+  std::size_t count;
+
+  void thread_jumps(instructionList &code);
+  void order_blocks(instructionList &code);
+  void remove_jumps_and_labels(instructionList &code);
+};
@@ -0,0 +1,396 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    cfg - Control flow graph of a t-code subroutine
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "cfg.h"
+
+#include <algorithm>
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'basicBlock'
+
+basicBlock::basicBlock(std::size_t id) : id(id), fallthrough(-1) {}
+
+operand basicBlock::get_label() const {
+  if (not instructions.empty() and instructions[0].oper == instruction::_LABEL)
+    return instructions[0].arg1;
+  return operand();
+}
+
+instruction * basicBlock::get_terminator() {
+  if (not instructions.empty() and instructions.back().ends_block())
+    return &instructions.back();
+  return nullptr;
+}
+const instruction * basicBlock::get_terminator() const {
+  return const_cast<basicBlock *>(this)->get_terminator();
+}
+
+std::string basicBlock::dump() const {
+  std::string s = "block " + std::to_string(id) + "  preds:";
+  for (auto p : preds) s += " " + std::to_string(p);
+  s += "  succs:";
+  for (auto b : succs) s += " " + std::to_string(b);
+  s += "\n";
+  for (auto &i : instructions) s += "  " + i.dump() + "\n";
+  return s;
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'controlFlowGraph'
+
+bool controlFlowGraph::loop::contains(std::size_t b) const {
+  return std::binary_search(blocks.begin(), blocks.end(), b);
+}
+
+/// constructors
+controlFlowGraph::controlFlowGraph(const instructionList &code) : frontierDone(false) {
+  build(code);
+}
+controlFlowGraph::controlFlowGraph(const subroutine &subr) : frontierDone(false) {
+  build(subr.get_instructions());
+}
+
+/// split the code in blocks: a block starts at a label or after a
+/// jump or return, and ends before the next label or at a jump/return
+void controlFlowGraph::build(const instructionList &code) {
+  // the entry block can not be the target of a jump: if the code
+  // starts with a label, it is left empty
+  blocks.push_back(basicBlock(0));
+  if (not code.empty() and code[0].oper == instruction::_LABEL)
+    blocks.push_back(basicBlock(1));
+  for (std::size_t pc = 0; pc < code.size(); ++pc) {
+    const instruction &i = code[pc];
+    if ((i.oper == instruction::_LABEL or (pc > 0 and code[pc-1].ends_block())) and
+        not blocks.back().instructions.empty())
+      blocks.push_back(basicBlock(blocks.size()));
+    if (i.oper == instruction::_LABEL)
+      labelBlock[i.arg1] = blocks.size()-1;
+    blocks.back().instructions.push_back(i);
+  }
+  for (auto &b : blocks)
+    layout.push_back(b.id);
+  link();
+  compute_dominators();
+  compute_loops();
+}
+
+/// create the edges between blocks
+void controlFlowGraph::link() {
+  for (auto &b : blocks) {
+    const instruction *t = b.get_terminator();
+    b.fallthrough = -1;
+    if (t == nullptr or t->oper == instruction::_FJUMP)
+      if (b.id + 1 < blocks.size()) {
+        b.fallthrough = b.id + 1;
+        b.succs.push_back(b.id + 1);
+      }
+    if (t != nullptr and t->is_jump()) {
+      int target = get_block_of_label(t->oper == instruction::_UJUMP ? t->arg1 : t->arg2);
+      if (target >= 0 and std::find(b.succs.begin(), b.succs.end(), std::size_t(target)) == b.succs.end())
+        b.succs.push_back(target);
+    }
+  }
+  for (auto &b : blocks)
+    for (auto s : b.succs)
+      blocks[s].preds.push_back(b.id);
+}
+
+/// reverse postorder, and dominator tree (Cooper, Harvey and Kennedy)
+void controlFlowGraph::compute_dominators() {
+  std::size_t n = blocks.size();
+
+  // depth first search from the entry, with an explicit stack
+  std::vector<std::size_t> post;
+  std::vector<bool> visited(n, false);
+  std::vector<std::pair<std::size_t, std::size_t>> stack;
+  stack.push_back(std::make_pair(0, 0));
+  visited[0] = true;
+  while (not stack.empty()) {
+    std::size_t b = stack.back().first, &k = stack.back().second;
+    if (k < blocks[b].succs.size()) {
+      std::size_t s = blocks[b].succs[k++];
+      if (not visited[s]) {
+        visited[s] = true;
+        stack.push_back(std::make_pair(s, 0));
+      }
+    }
+    else {
+      post.push_back(b);
+      stack.pop_back();
+    }
+  }
+  rpo.assign(post.rbegin(), post.rend());
+  rpoNumber.assign(n, -1);
+  for (std::size_t k = 0; k < rpo.size(); ++k)
+    rpoNumber[rpo[k]] = k;
+
+  // iterate until immediate dominators do not change
+  idom.assign(n, -1);
+  idom[0] = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::size_t k = 1; k < rpo.size(); ++k) {
+      std::size_t b = rpo[k];
+      int newIdom = -1;
+      for (auto p : blocks[b].preds) {
+        if (idom[p] < 0) continue;
+        if (newIdom < 0) { newIdom = p; continue; }
+        int x = p, y = newIdom;
+        while (x != y) {
+          while (rpoNumber[x] > rpoNumber[y]) x = idom[x];
+          while (rpoNumber[y] > rpoNumber[x]) y = idom[y];
+        }
+        newIdom = x;
+      }
+      if (idom[b] != newIdom) {
+        idom[b] = newIdom;
+        changed = true;
+      }
+    }
+  }
+  idom[0] = -1;
+
+  // children in the tree, and pre/post numbering for dominance tests
+  domChildren.assign(n, std::vector<std::size_t>());
+  for (auto b : rpo)
+    if (idom[b] >= 0) domChildren[idom[b]].push_back(b);
+  domPre.assign(n, 0);
+  domPost.assign(n, 0);
+  std::size_t counter = 0;
+  std::vector<std::pair<std::size_t, std::size_t>> walk;
+  walk.push_back(std::make_pair(0, 0));
+  domPre[0] = counter++;
+  while (not walk.empty()) {
+    std::size_t b = walk.back().first, &k = walk.back().second;
+    if (k < domChildren[b].size()) {
+      std::size_t c = domChildren[b][k++];
+      domPre[c] = counter++;
+      walk.push_back(std::make_pair(c, 0));
+    }
+    else {
+      domPost[b] = counter++;
+      walk.pop_back();
+    }
+  }
+}
+
+/// natural loops of the back edges (edges to a dominator)
+void controlFlowGraph::compute_loops() {
+  std::map<std::size_t, std::size_t> loopOfHeader;
+  for (auto b : rpo)
+    for (auto h : blocks[b].succs)
+      if (dominates(h, b)) {
+        if (loopOfHeader.find(h) == loopOfHeader.end()) {
+          loopOfHeader[h] = loops.size();
+          loops.push_back(loop());
+          loops.back().header = h;
+          loops.back().blocks.push_back(h);
+        }
+        loop &l = loops[loopOfHeader[h]];
+        l.latches.push_back(b);
+        // walk backwards from the latch up to the header
+        std::vector<bool> inLoop(blocks.size(), false);
+        for (auto x : l.blocks) inLoop[x] = true;
+        std::vector<std::size_t> work(1, b);
+        while (not work.empty()) {
+          std::size_t x = work.back();
+          work.pop_back();
+          if (inLoop[x]) continue;
+          inLoop[x] = true;
+          l.blocks.push_back(x);
+          for (auto p : blocks[x].preds)
+            if (is_reachable(p)) work.push_back(p);
+        }
+      }
+
+  // outer loops first (bigger ones), then find parents and depths
+  for (auto &l : loops)
+    std::sort(l.blocks.begin(), l.blocks.end());
+  std::stable_sort(loops.begin(), loops.end(),
+                   [](const loop &a, const loop &b) { return a.blocks.size() > b.blocks.size(); });
+  loopOf.assign(blocks.size(), -1);
+  for (std::size_t k = 0; k < loops.size(); ++k) {
+    loop &l = loops[k];
+    l.parent = loopOf[l.header];
+    l.depth = l.parent < 0 ? 1 : loops[l.parent].depth + 1;
+    for (auto b : l.blocks)
+      loopOf[b] = k;
+  }
+}
+
+/// blocks
+std::size_t controlFlowGraph::get_num_blocks() const { return blocks.size(); }
+basicBlock & controlFlowGraph::get_block(std::size_t b) { return blocks[b]; }
+const basicBlock & controlFlowGraph::get_block(std::size_t b) const { return blocks[b]; }
+int controlFlowGraph::get_block_of_label(const operand &lab) const {
+  auto it = labelBlock.find(lab);
+  return it == labelBlock.end() ? -1 : int(it->second);
+}
+
+const std::vector<std::size_t> & controlFlowGraph::get_reverse_postorder() const { return rpo; }
+bool controlFlowGraph::is_reachable(std::size_t b) const { return rpoNumber[b] >= 0; }
+
+/// dominators
+int controlFlowGraph::get_idom(std::size_t b) const { return idom[b]; }
+const std::vector<std::size_t> & controlFlowGraph::get_dom_children(std::size_t b) const { return domChildren[b]; }
+bool controlFlowGraph::dominates(std::size_t a, std::size_t b) const {
+  if (not is_reachable(a) or not is_reachable(b)) return false;
+  return domPre[a] <= domPre[b] and domPost[b] <= domPost[a];
+}
+
+const std::vector<std::size_t> & controlFlowGraph::get_dom_frontier(std::size_t b) const {
+  if (not frontierDone) {
+    domFrontier.assign(blocks.size(), std::vector<std::size_t>());
+    for (auto x : rpo) {
+      if (blocks[x].preds.size() < 2) continue;
+      for (auto p : blocks[x].preds) {
+        if (not is_reachable(p)) continue;
+        int runner = p;
+        while (runner >= 0 and runner != idom[x]) {
+          std::vector<std::size_t> &df = domFrontier[runner];
+          if (std::find(df.begin(), df.end(), x) == df.end()) df.push_back(x);
+          runner = idom[runner];
+        }
+      }
+    }
+    frontierDone = true;
+  }
+  return domFrontier[b];
+}
+
+/// loops
+const std::vector<controlFlowGraph::loop> & controlFlowGraph::get_loops() const { return loops; }
+int controlFlowGraph::get_loop_of(std::size_t b) const { return loopOf[b]; }
+int controlFlowGraph::get_loop_depth(std::size_t b) const {
+  return loopOf[b] < 0 ? 0 : loops[loopOf[b]].depth;
+}
+
+/// change the edges
+void controlFlowGraph::remove_edge(std::size_t from, std::size_t to) {
+  basicBlock &f = blocks[from], &t = blocks[to];
+  f.succs.erase(std::find(f.succs.begin(), f.succs.end(), to));
+  t.preds.erase(std::find(t.preds.begin(), t.preds.end(), from));
+  if (f.fallthrough == int(to)) f.fallthrough = -1;
+}
+
+void controlFlowGraph::update() {
+  compute_dominators();
+  loops.clear();
+  compute_loops();
+  frontierDone = false;
+}
+
+std::size_t controlFlowGraph::insert_block(std::size_t b, const std::vector<std::size_t> &from) {
+  std::size_t n = blocks.size();
+  blocks.push_back(basicBlock(n));
+  basicBlock &p = blocks[n], &succ = blocks[b];
+  operand target = succ.get_label(), lab;
+  for (auto f : from) {
+    basicBlock &pred = blocks[f];
+    instruction *t = pred.get_terminator();
+    if (t != nullptr and t->is_jump()) {
+      operand &jump = t->oper == instruction::_UJUMP ? t->arg1 : t->arg2;
+      if (not target.empty() and jump == target) {
+        if (lab.empty()) {
+          lab = new_label();
+          p.instructions.append(instruction::LABEL(lab));
+          labelBlock[lab] = n;
+        }
+        jump = lab;
+      }
+    }
+    std::replace(pred.succs.begin(), pred.succs.end(), b, n);
+    if (pred.fallthrough == int(b)) pred.fallthrough = n;
+    succ.preds.erase(std::find(succ.preds.begin(), succ.preds.end(), f));
+    p.preds.push_back(f);
+  }
+  p.succs.push_back(b);
+  p.fallthrough = b;
+  succ.preds.push_back(n);
+  layout.insert(std::find(layout.begin(), layout.end(), b), n);
+  return n;
+}
+
+/// a label "bbN" not used yet
+operand controlFlowGraph::new_label() const {
+  int base = 0;
+  for (auto &l : labelBlock)
+    if (l.first == operand::LABEL("bb", l.first.get_value()))
+      base = std::max(base, l.first.get_value() + 1);
+  return operand::LABEL("bb", base);
+}
+
+/// back to a linear instruction list
+instructionList controlFlowGraph::linearize() const {
+  return linearize(layout);
+}
+
+instructionList controlFlowGraph::linearize(const std::vector<std::size_t> &order) const {
+  // find blocks reached by a new "goto", and a free number for their labels
+  std::vector<bool> needsLabel(blocks.size(), false);
+  std::size_t total = 0;
+  for (std::size_t k = 0; k < order.size(); ++k) {
+    const basicBlock &b = blocks[order[k]];
+    total += b.instructions.size() + 2;
+    if (b.fallthrough >= 0 and (k+1 == order.size() or order[k+1] != std::size_t(b.fallthrough)) and
+        blocks[b.fallthrough].get_label().empty())
+      needsLabel[b.fallthrough] = true;
+  }
+  int base = new_label().get_value();
+
+  instructionList code;
+  code.reserve(total);
+  for (std::size_t k = 0; k < order.size(); ++k) {
+    const basicBlock &b = blocks[order[k]];
+    if (needsLabel[b.id])
+      code.append(instruction::LABEL(operand::LABEL("bb", base + b.id)));
+    code.append(b.instructions);
+    if (b.fallthrough >= 0 and (k+1 == order.size() or order[k+1] != std::size_t(b.fallthrough))) {
+      operand lab = blocks[b.fallthrough].get_label();
+      code.append(instruction::UJUMP(lab.empty() ? operand::LABEL("bb", base + b.fallthrough) : lab));
+    }
+  }
+  return code;
+}
+
+/// print (for debugging)
+std::string controlFlowGraph::dump() const {
+  std::string s;
+  for (auto &b : blocks) {
+    s += b.dump();
+    s += "  idom: " + std::to_string(idom[b.id]);
+    if (loopOf[b.id] >= 0)
+      s += "  loop header: " + std::to_string(loops[loopOf[b.id]].header) +
+           "  depth: " + std::to_string(get_loop_depth(b.id));
+    s += "\n";
+  }
+  return s;
+}
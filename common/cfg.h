@@ -0,0 +1,169 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    cfg - Control flow graph of a t-code subroutine
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <map>
+#include <vector>
+#include <string>
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class basicBlock stores a maximal sequence of instructions that
+/// is always executed from the first one to the last one. A block
+/// keeps its own LABEL (first instruction) and jump (last one), so
+/// its code is valid t-code by itself.
+
+class basicBlock {
+public:
+  /// position of the block in the graph
+  std::size_t id;
+  /// instructions of the block
+  instructionList instructions;
+  /// predecessor and successor blocks (by id). When the block ends
+  /// with a conditional jump, succs[0] is the fall-through block.
+  std::vector<std::size_t> preds, succs;
+  /// block executed next when the last instruction does not jump
+  /// (-1 if the block ends with "goto" or "return", or is the last one)
+  int fallthrough;
+
+  /// constructor
+  basicBlock(std::size_t id);
+
+  /// label of the block (empty operand if it has none)
+  operand get_label() const;
+  /// last instruction, if it ends the block (jump or return), or nullptr
+  instruction * get_terminator();
+  const instruction * get_terminator() const;
+
+  // print block (for debugging)
+  std::string dump() const;
+};
+
+
+////////////////////////////////////////////////////////////////////
+/// Class controlFlowGraph splits the instructions of a subroutine
+/// into basic blocks, links them, and computes the dominator tree
+/// and the natural loops (with their nesting). Block 0 is the entry
+/// (it has no predecessors, so it is empty if the code starts with a label).
+/// Passes may change the instructions of the blocks and then get
+/// them back as a linear list with linearize().
+
+class controlFlowGraph {
+public:
+  /// Class loop stores a natural loop: a header that dominates all
+  /// the blocks of the loop, and the latches jumping back to it.
+  class loop {
+  public:
+    std::size_t header;
+    /// blocks of the loop (including inner loops), sorted by id
+    std::vector<std::size_t> blocks;
+    /// blocks of the loop with an edge to the header
+    std::vector<std::size_t> latches;
+    /// enclosing loop (-1 if outermost) and nesting depth (1 if outermost)
+    int parent;
+    int depth;
+
+    bool contains(std::size_t b) const;
+  };
+
+  /// constructors: from an instruction list, or from a subroutine
+  controlFlowGraph(const instructionList &code);
+  controlFlowGraph(const subroutine &subr);
+
+  /// blocks
+  std::size_t get_num_blocks() const;
+  basicBlock & get_block(std::size_t b);
+  const basicBlock & get_block(std::size_t b) const;
+  /// block starting with the given label (-1 if there is none)
+  int get_block_of_label(const operand &lab) const;
+
+  /// blocks in reverse postorder from the entry (unreachable blocks excluded)
+  const std::vector<std::size_t> & get_reverse_postorder() const;
+  /// block can be reached from the entry
+  bool is_reachable(std::size_t b) const;
+
+  /// dominator tree: immediate dominator (-1 for the entry and
+  /// unreachable blocks), children of a block, and dominance test
+  int get_idom(std::size_t b) const;
+  const std::vector<std::size_t> & get_dom_children(std::size_t b) const;
+  bool dominates(std::size_t a, std::size_t b) const;
+  /// dominance frontier of a block
+  const std::vector<std::size_t> & get_dom_frontier(std::size_t b) const;
+
+  /// natural loops, outer loops before inner ones
+  const std::vector<loop> & get_loops() const;
+  /// innermost loop containing a block (-1 if none), and its depth (0 if none)
+  int get_loop_of(std::size_t b) const;
+  int get_loop_depth(std::size_t b) const;
+
+  /// remove the edge between two blocks (the caller changes the jump
+  /// at the end of 'from'), and recompute dominators and loops after
+  /// changing the edges
+  void remove_edge(std::size_t from, std::size_t to);
+  void update();
+  /// add an empty block placed just before block b, and move to it
+  /// the edges from the given predecessors of b (their jumps to b
+  /// jump to a new label "bbN" of the block). Returns the new block.
+  std::size_t insert_block(std::size_t b, const std::vector<std::size_t> &from);
+
+  /// instructions of all the blocks, in layout order (the order of
+  /// the code, with inserted blocks before their successor), or in the given
+  /// order, which may leave out unreachable blocks). A block that falls
+  /// through to a block that is not the next one gets a "goto" (and
+  /// its target a new label "bbN", if it had none).
+  instructionList linearize() const;
+  instructionList linearize(const std::vector<std::size_t> &order) const;
+
+  // print graph (for debugging)
+  std::string dump() const;
+
+private:
+  std::vector<basicBlock> blocks;
+  std::vector<std::size_t> layout;
+  std::map<operand, std::size_t> labelBlock;
+
+  std::vector<std::size_t> rpo;
+  std::vector<int> rpoNumber;
+  std::vector<int> idom;
+  std::vector<std::vector<std::size_t>> domChildren;
+  std::vector<std::size_t> domPre, domPost;
+  mutable std::vector<std::vector<std::size_t>> domFrontier;
+  mutable bool frontierDone;
+  std::vector<loop> loops;
+  std::vector<int> loopOf;
+
+  void build(const instructionList &code);
+  void link();
+  void compute_dominators();
+  void compute_loops();
+  operand new_label() const;
+};
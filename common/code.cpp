@@ -27,73 +27,267 @@
 ////////////////////////////////////////////////////////////////
 
 #include <iostream>
+#include <iterator>
+#include <utility>
+#include <unordered_set>
+#include <mutex>
+#include <cstdlib>
 #include "code.h"
 
 using namespace std;
 
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'operand'
+
+/// Constructors
+operand::operand() : kind(_NONE), value(0), text(nullptr) {}
+operand::operand(Kind k, int v, const std::string *t) : kind(k), value(v), text(t) {}
+
+operand::operand(const std::string &s) : kind(_NONE), value(0), text(nullptr) {
+  if (s.empty()) return;
+  if (s.size() > 1 and s[0] == '%' and s.find_first_not_of("0123456789", 1) == string::npos) {
+    kind = _TEMP;
+    value = std::atoi(s.c_str()+1);
+  }
+  else {
+    kind = _NAME;
+    text = intern(s);
+  }
+}
+operand::operand(const char *s) : operand(std::string(s)) {}
+
+operand operand::TEMP(int n) { return operand(_TEMP, n, nullptr); }
+operand operand::NAME(const std::string &s) { return operand(_NAME, 0, intern(s)); }
+operand operand::ICONST(int v) { return operand(_ICONST, v, nullptr); }
+operand operand::ICONST(const std::string &s) {
+  int v = int(std::strtol(s.c_str(), nullptr, 10));
+  // keep the spelling only when printing the value would not reproduce it
+  return operand(_ICONST, v, std::to_string(v) == s ? nullptr : intern(s));
+}
+operand operand::FCONST(const std::string &s) { return operand(_FCONST, 0, intern(s)); }
+operand operand::CHCONST(const std::string &s) { return operand(_CHCONST, 0, intern(s)); }
+operand operand::STRCONST(const std::string &s, int n) { return operand(_STRCONST, n, intern(s)); }
+operand operand::LABEL(const std::string &prefix, int n) {
+  operand o(_LABEL, n, nullptr);
+  o.label.family = label_family(prefix);
+  o.label.target = -1;
+  return o;
+}
+operand operand::LABEL(const std::string &s) {
+  // split trailing digits as label number (unless they would not print back the same)
+  size_t p = s.find_last_not_of("0123456789") + 1;
+  if (p == s.size() or p == 0 or (s[p] == '0' and p+1 < s.size()) or s.size()-p > 9)
+    return LABEL(s, -1);
+  return LABEL(s.substr(0, p), std::atoi(s.c_str()+p));
+}
+
+/// interned strings live until the end of the program, so operands
+/// can refer to them by pointer
+const std::string *operand::intern(const std::string &s) {
+  static std::unordered_set<std::string> pool;
+  static std::mutex poolMutex;
+  std::lock_guard<std::mutex> lock(poolMutex);
+  return &*pool.insert(s).first;
+}
+
+/// label prefixes are few ("else", "endif", ...), kept in a table
+/// so that a label is just two numbers
+static std::vector<const std::string *> &labelFamilies() {
+  static std::vector<const std::string *> families;
+  return families;
+}
+static std::mutex familiesMutex;
+
+int operand::label_family(const std::string &prefix) {
+  const std::string *p = intern(prefix);
+  std::lock_guard<std::mutex> lock(familiesMutex);
+  std::vector<const std::string *> &families = labelFamilies();
+  for (size_t i = 0; i < families.size(); ++i)
+    if (families[i] == p) return int(i);
+  families.push_back(p);
+  return int(families.size()) - 1;
+}
+const std::string & operand::label_prefix(int family) {
+  std::lock_guard<std::mutex> lock(familiesMutex);
+  return *labelFamilies()[family];
+}
+
+/// Accessors
+operand::Kind operand::get_kind() const { return kind; }
+bool operand::empty() const { return kind == _NONE; }
+bool operand::is_temp() const { return kind == _TEMP; }
+bool operand::is_name() const { return kind == _NAME; }
+bool operand::is_const() const { return kind == _ICONST or kind == _FCONST or kind == _CHCONST; }
+bool operand::is_label() const { return kind == _LABEL; }
+int operand::get_value() const { return value; }
+const std::string & operand::get_name() const {
+  static const std::string none;
+  return (kind != _LABEL and text) ? *text : none;
+}
+int operand::get_target() const { return kind == _LABEL ? label.target : -1; }
+void operand::set_target(int pc) { if (kind == _LABEL) label.target = pc; }
+
+/// Comparison
+bool operand::operator==(const operand &o) const {
+  if (kind != o.kind or value != o.value) return false;
+  if (kind == _LABEL) return label.family == o.label.family;
+  return kind == _ICONST or text == o.text;
+}
+bool operand::operator!=(const operand &o) const { return not (*this == o); }
+bool operand::operator<(const operand &o) const {
+  if (kind != o.kind) return kind < o.kind;
+  if (value != o.value) return value < o.value;
+  if (kind == _ICONST) return false;
+  if (kind == _LABEL) return label.family < o.label.family;
+  return text < o.text;
+}
+
+/// print operand
+string operand::dump() const {
+  switch (kind) {
+  case _NONE : return "";
+  case _TEMP : return "%" + std::to_string(value);
+  case _ICONST : return text ? *text : std::to_string(value);
+  case _LABEL : return label_prefix(label.family) + (value < 0 ? "" : std::to_string(value));
+  case _STRCONST : return value < 0 ? "\"" + *text + "\"" : "str" + std::to_string(value);
+  default : return *text;
+  }
+}
+
 ////////////////////////////////////////////////////////////////////
 /// Implementation for class 'instruction'
 
 /// Constructor
 instruction::instruction(Operation op,
-                         const std::string &a1, const std::string &a2, const std::string &a3) {
+                         const operand &a1, const operand &a2, const operand &a3) {
   oper = op;
   arg1 = a1;
   arg2 = a2;
   arg3 = a3;
 }
 
-instruction instruction::LABEL(const std::string &a1) { return instruction(_LABEL, a1); }
-instruction instruction::UJUMP(const std::string &a1) { return instruction(_UJUMP, a1); }
-instruction instruction::FJUMP(const std::string &a1, const std::string &a2) { return instruction(_FJUMP, a1, a2); }
-instruction instruction::PUSH(const std::string &a1) { return instruction(_PUSH, a1); }
-instruction instruction::POP(const std::string &a1) { return instruction(_POP, a1); }
-instruction instruction::CALL(const std::string &a1) { return instruction(_CALL, a1); }
+// constants and labels given by their spelling come in as plain names
+static operand as_label(const operand &a) { return a.is_name() ? operand::LABEL(a.get_name()) : a; }
+
+instruction instruction::LABEL(const operand &a1) { return instruction(_LABEL, as_label(a1)); }
+instruction instruction::UJUMP(const operand &a1) { return instruction(_UJUMP, as_label(a1)); }
+instruction instruction::FJUMP(const operand &a1, const operand &a2) { return instruction(_FJUMP, a1, as_label(a2)); }
+instruction instruction::PUSH(const operand &a1) { return instruction(_PUSH, a1); }
+instruction instruction::POP(const operand &a1) { return instruction(_POP, a1); }
+instruction instruction::CALL(const operand &a1) { return instruction(_CALL, a1); }
 instruction instruction::RETURN() { return instruction(_RETURN); }
-instruction instruction::ADD(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_ADD, a1, a2, a3); }
-instruction instruction::SUB(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_SUB, a1, a2, a3); }
-instruction instruction::MUL(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_MUL, a1, a2, a3); }
-instruction instruction::DIV(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_DIV, a1, a2, a3); }
-instruction instruction::EQ(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_EQ, a1, a2, a3); }
-instruction instruction::LT(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_LT, a1, a2, a3); }
-instruction instruction::LE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_LE, a1, a2, a3); }
-instruction instruction::AND(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_AND, a1, a2, a3); }
-instruction instruction::OR(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_OR, a1, a2, a3); }
-instruction instruction::FADD(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FADD, a1, a2, a3); }
-instruction instruction::FSUB(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FSUB, a1, a2, a3); }
-instruction instruction::FMUL(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FMUL, a1, a2, a3); }
-instruction instruction::FDIV(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FDIV, a1, a2, a3); }
-instruction instruction::FEQ(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FEQ, a1, a2, a3); }
-instruction instruction::FLT(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FLT, a1, a2, a3); }
-instruction instruction::FLE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FLE, a1, a2, a3); }
-instruction instruction::NOT(const std::string &a1, const std::string &a2) { return instruction(_NOT, a1, a2); }
-instruction instruction::NEG(const std::string &a1, const std::string &a2) { return instruction(_NEG, a1, a2); }
-instruction instruction::FNEG(const std::string &a1, const std::string &a2) { return instruction(_FNEG, a1, a2); }
-instruction instruction::FLOAT(const std::string &a1, const std::string &a2) { return instruction(_FLOAT, a1, a2); }  
-instruction instruction::LOAD(const std::string &a1, const std::string &a2) { return instruction(_LOAD, a1, a2); }
-instruction instruction::ILOAD(const std::string &a1, const std::string &a2) { return instruction(_ILOAD, a1, a2); }
-instruction instruction::CHLOAD(const std::string &a1, const std::string &a2) { return instruction(_CHLOAD, a1, a2); }
-instruction instruction::FLOAD(const std::string &a1, const std::string &a2) { return instruction(_FLOAD, a1, a2); }
-instruction instruction::XLOAD(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_XLOAD, a1, a2, a3); }
-instruction instruction::LOADX(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_LOADX, a1, a2, a3); }
-instruction instruction::ALOAD(const std::string &a1, const std::string &a2) { return instruction(_ALOAD, a1, a2); }
-instruction instruction::LOADC(const std::string &a1, const std::string &a2) { return instruction(_LOADC, a1, a2); }
-instruction instruction::CLOAD(const std::string &a1, const std::string &a2) { return instruction(_CLOAD, a1, a2); }
-instruction instruction::READI(const std::string &a1) { return instruction(_READI, a1); }
-instruction instruction::READF(const std::string &a1) { return instruction(_READF, a1); }
-instruction instruction::READC(const std::string &a1) { return instruction(_READC, a1); }
-instruction instruction::WRITEI(const std::string &a1) { return instruction(_WRITEI, a1); }
-instruction instruction::WRITEF(const std::string &a1) { return instruction(_WRITEF, a1); }
-instruction instruction::WRITEC(const std::string &a1) { return instruction(_WRITEC, a1); }
+instruction instruction::ADD(const operand &a1, const operand &a2, const operand &a3) { return instruction(_ADD, a1, a2, a3); }
+instruction instruction::SUB(const operand &a1, const operand &a2, const operand &a3) { return instruction(_SUB, a1, a2, a3); }
+instruction instruction::MUL(const operand &a1, const operand &a2, const operand &a3) { return instruction(_MUL, a1, a2, a3); }
+instruction instruction::DIV(const operand &a1, const operand &a2, const operand &a3) { return instruction(_DIV, a1, a2, a3); }
+instruction instruction::EQ(const operand &a1, const operand &a2, const operand &a3) { return instruction(_EQ, a1, a2, a3); }
+instruction instruction::LT(const operand &a1, const operand &a2, const operand &a3) { return instruction(_LT, a1, a2, a3); }
+instruction instruction::LE(const operand &a1, const operand &a2, const operand &a3) { return instruction(_LE, a1, a2, a3); }
+instruction instruction::AND(const operand &a1, const operand &a2, const operand &a3) { return instruction(_AND, a1, a2, a3); }
+instruction instruction::OR(const operand &a1, const operand &a2, const operand &a3) { return instruction(_OR, a1, a2, a3); }
+instruction instruction::FADD(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FADD, a1, a2, a3); }
+instruction instruction::FSUB(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FSUB, a1, a2, a3); }
+instruction instruction::FMUL(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FMUL, a1, a2, a3); }
+instruction instruction::FDIV(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FDIV, a1, a2, a3); }
+instruction instruction::FEQ(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FEQ, a1, a2, a3); }
+instruction instruction::FLT(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FLT, a1, a2, a3); }
+instruction instruction::FLE(const operand &a1, const operand &a2, const operand &a3) { return instruction(_FLE, a1, a2, a3); }
+instruction instruction::NOT(const operand &a1, const operand &a2) { return instruction(_NOT, a1, a2); }
+instruction instruction::NEG(const operand &a1, const operand &a2) { return instruction(_NEG, a1, a2); }
+instruction instruction::FNEG(const operand &a1, const operand &a2) { return instruction(_FNEG, a1, a2); }
+instruction instruction::FLOAT(const operand &a1, const operand &a2) { return instruction(_FLOAT, a1, a2); }  
+instruction instruction::LOAD(const operand &a1, const operand &a2) { return instruction(_LOAD, a1, a2); }
+instruction instruction::ILOAD(const operand &a1, const operand &a2) {
+  return instruction(_ILOAD, a1, a2.is_name() ? operand::ICONST(a2.get_name()) : a2);
+}
+instruction instruction::CHLOAD(const operand &a1, const operand &a2) {
+  return instruction(_CHLOAD, a1, a2.is_name() ? operand::CHCONST(a2.get_name()) : a2);
+}
+instruction instruction::FLOAD(const operand &a1, const operand &a2) {
+  return instruction(_FLOAD, a1, a2.is_name() ? operand::FCONST(a2.get_name()) : a2);
+}
+instruction instruction::XLOAD(const operand &a1, const operand &a2, const operand &a3) { return instruction(_XLOAD, a1, a2, a3); }
+instruction instruction::LOADX(const operand &a1, const operand &a2, const operand &a3) { return instruction(_LOADX, a1, a2, a3); }
+instruction instruction::ALOAD(const operand &a1, const operand &a2) { return instruction(_ALOAD, a1, a2); }
+instruction instruction::LOADC(const operand &a1, const operand &a2) { return instruction(_LOADC, a1, a2); }
+instruction instruction::CLOAD(const operand &a1, const operand &a2) { return instruction(_CLOAD, a1, a2); }
+instruction instruction::READI(const operand &a1) { return instruction(_READI, a1); }
+instruction instruction::READF(const operand &a1) { return instruction(_READF, a1); }
+instruction instruction::READC(const operand &a1) { return instruction(_READC, a1); }
+instruction instruction::WRITEI(const operand &a1) { return instruction(_WRITEI, a1); }
+instruction instruction::WRITEF(const operand &a1) { return instruction(_WRITEF, a1); }
+instruction instruction::WRITEC(const operand &a1) { return instruction(_WRITEC, a1); }
 instruction instruction::WRITELN() { return instruction(_WRITELN); }
+instruction instruction::WRITES(const operand &a1, const operand &a2) { return instruction(_WRITES, a1, a2); }
 instruction instruction::NOOP() { return instruction(_NOOP); }
 
 
+/// data-flow information
+operand * instruction::get_def() {
+  switch (oper) {
+  case _POP: return arg1.empty() ? nullptr : &arg1;
+  case _ADD: case _SUB: case _MUL: case _DIV: case _EQ: case _LT: case _LE:
+  case _AND: case _OR: case _FADD: case _FSUB: case _FMUL: case _FDIV:
+  case _FEQ: case _FLT: case _FLE: case _NEG: case _NOT: case _FNEG: case _FLOAT:
+  case _LOAD: case _ILOAD: case _CHLOAD: case _FLOAD: case _LOADX: case _ALOAD: case _LOADC:
+  case _READI: case _READF: case _READC:
+    return &arg1;
+  default:
+    return nullptr;
+  }
+}
+const operand * instruction::get_def() const {
+  return const_cast<instruction *>(this)->get_def();
+}
+
+int instruction::get_uses(operand *u[3]) {
+  int n = 0;
+  switch (oper) {
+  case _FJUMP: case _WRITEI: case _WRITEF: case _WRITEC:
+    u[n++] = &arg1; break;
+  case _PUSH:
+    if (not arg1.empty()) u[n++] = &arg1;
+    break;
+  case _ADD: case _SUB: case _MUL: case _DIV: case _EQ: case _LT: case _LE:
+  case _AND: case _OR: case _FADD: case _FSUB: case _FMUL: case _FDIV:
+  case _FEQ: case _FLT: case _FLE: case _LOADX:
+    u[n++] = &arg2; u[n++] = &arg3; break;
+  case _NEG: case _NOT: case _FNEG: case _FLOAT: case _LOAD: case _LOADC:
+    u[n++] = &arg2; break;
+  case _XLOAD:
+    u[n++] = &arg1; u[n++] = &arg2; u[n++] = &arg3; break;
+  case _CLOAD:
+    u[n++] = &arg1; u[n++] = &arg2; break;
+  default:
+    break;
+  }
+  return n;
+}
+int instruction::get_uses(const operand *u[3]) const {
+  return const_cast<instruction *>(this)->get_uses(const_cast<operand **>(u));
+}
+
+bool instruction::is_jump() const { return oper == _UJUMP or oper == _FJUMP; }
+bool instruction::ends_block() const { return is_jump() or oper == _RETURN; }
+bool instruction::reads_memory() const { return oper == _LOADX or oper == _LOADC or oper == _CALL; }
+bool instruction::writes_memory() const { return oper == _XLOAD or oper == _CLOAD or oper == _CALL; }
+bool instruction::has_side_effects() const {
+  switch (oper) {
+  case _LABEL: case _UJUMP: case _FJUMP: case _PUSH: case _POP: case _CALL: case _RETURN:
+  case _XLOAD: case _CLOAD: case _READI: case _READF: case _READC:
+  case _WRITEI: case _WRITEF: case _WRITEC: case _WRITELN: case _WRITES: case _INVALID:
+    return true;
+  default:
+    return false;
+  }
+}
+
 /// Destructor
 instruction::~instruction() {}
 
 string instruction::dump() const {
   string s;
+  string arg1 = this->arg1.dump(), arg2 = this->arg2.dump(), arg3 = this->arg3.dump();
   string ind="   ";
   switch (oper) {
   case instruction::_LABEL : { s = "label " + arg1 + " :"; ind = ""; break; }
@@ -119,6 +313,7 @@ string instruction::dump() const {
   case instruction::_WRITEF : { s = "writef " + arg1; break; }
   case instruction::_WRITEC : { s = "writec " + arg1; break; }
   case instruction::_WRITELN : { s = "writeln"; break; }
+  case instruction::_WRITES : { s = "writes " + arg2; break; }
   case instruction::_ADD : { s = arg1 + " = " + arg2 + " + " + arg3; break; }
   case instruction::_SUB : { s = arg1 + " = " + arg2 + " - " + arg3; break; }
   case instruction::_MUL : { s = arg1 + " = " + arg2 + " * " + arg3; break; }
@@ -153,6 +348,10 @@ instructionList instruction::operator||(const instructionList &lst) const {
   return instructionList(*this) || lst;
 }
 
+instructionList instruction::operator||(instructionList &&lst) const {
+  return instructionList(*this) || std::move(lst);
+}
+
 
 ////////////////////////////////////////////////////////////////////
 /// Implementation for class 'instructionList'
@@ -165,12 +364,47 @@ instructionList::instructionList(const instruction &inst) { this->push_back(inst
 instructionList::~instructionList() {}
 
 // concatenation of lists (or list+instruction, via automatic coertion)
-instructionList instructionList::operator||(const instructionList &lst) const {
-  instructionList newlist = (*this);
+instructionList instructionList::operator||(const instructionList &lst) const & {
+  instructionList newlist;
+  newlist.reserve(this->size() + lst.size());
+  newlist.insert(newlist.end(), this->begin(), this->end());
   newlist.insert(newlist.end(), lst.begin(), lst.end());
   return newlist;
 }
 
+// concatenation on a temporary left operand: append in place and hand it over
+instructionList instructionList::operator||(const instructionList &lst) && {
+  this->append(lst);
+  return std::move(*this);
+}
+
+instructionList instructionList::operator||(instructionList &&lst) && {
+  this->append(std::move(lst));
+  return std::move(*this);
+}
+
+// append a list at the end of this one
+instructionList & instructionList::append(const instructionList &lst) {
+  this->insert(this->end(), lst.begin(), lst.end());
+  return *this;
+}
+
+// append a list at the end of this one, moving its instructions
+instructionList & instructionList::append(instructionList &&lst) {
+  if (this->empty())
+    this->swap(lst);
+  else
+    this->insert(this->end(), std::make_move_iterator(lst.begin()),
+                              std::make_move_iterator(lst.end()));
+  return *this;
+}
+
+// append a single instruction at the end of this list
+instructionList & instructionList::append(const instruction &inst) {
+  this->push_back(inst);
+  return *this;
+}
+
 // print instructionList (for debugging)
 string instructionList::dump() const {
   string s;  
@@ -226,15 +460,78 @@ void subroutine::add_instructions(const instructionList &lins) {
 /// set instruction list (overwritting current instructions)
 void subroutine::set_instructions(const instructionList &lins) {
   instructions.clear();
+  labels.clear();
   this->add_instructions(lins);
 }
+/// set instruction list, taking ownership of the given one
+void subroutine::set_instructions(instructionList &&lins) {
+  instructions = std::move(lins);
+  labels.clear();
+  for (size_t pc = 0; pc < instructions.size(); ++pc)
+    if (instructions[pc].oper == instruction::_LABEL)
+      labels.insert(make_pair(instructions[pc].arg1, pc));
+}
 /// get instruction at given program counter
 instruction subroutine::get_instruction_at(size_t pc) const {
   if (pc>=instructions.size()) return instruction(instruction::_INVALID);
   return instructions[pc];
 }
+/// get all the instructions
+const instructionList & subroutine::get_instructions() const { return instructions; }
 /// get program counter for given label
-size_t subroutine::get_label_pc(std::string &lab) const { return labels.find(lab)->second; }
+size_t subroutine::get_label_pc(const operand &lab) const {
+  if (lab.get_target() >= 0) return lab.get_target();
+  return labels.find(as_label(lab))->second;
+}
+/// resolve jump targets to program counters
+void subroutine::finalize() {
+  for (size_t pc = 0; pc < instructions.size(); ++pc) {
+    instruction &i = instructions[pc];
+    operand *lab = (i.oper == instruction::_LABEL or i.oper == instruction::_UJUMP) ? &i.arg1
+                   : i.oper == instruction::_FJUMP ? &i.arg2 : nullptr;
+    if (lab == nullptr) continue;
+    auto it = labels.find(*lab);
+    if (it != labels.end()) lab->set_target(int(it->second));
+  }
+}
+/// lower write-string instructions
+void subroutine::lower_strings() {
+  instructionList lowered;
+  bool found = false;
+  for (auto &i : instructions) {
+    if (i.oper != instruction::_WRITES) {
+      lowered.append(i);
+      continue;
+    }
+    found = true;
+    const string &s = i.arg2.get_name();
+    size_t k = 0;
+    while (k < s.size()) {
+      if (s[k] != '\\' or k+1 == s.size()) {
+        lowered.append(instruction::CHLOAD(i.arg1, operand::CHCONST(s.substr(k,1))));
+        lowered.append(instruction::WRITEC(i.arg1));
+        k += 1;
+      }
+      else if (s[k+1] == 'n') {
+        lowered.append(instruction::WRITELN());
+        k += 2;
+      }
+      else if (s[k+1] == 't' or s[k+1] == '"' or s[k+1] == '\\') {
+        lowered.append(instruction::CHLOAD(i.arg1, operand::CHCONST(s.substr(k,2))));
+        lowered.append(instruction::WRITEC(i.arg1));
+        k += 2;
+      }
+      else {
+        lowered.append(instruction::CHLOAD(i.arg1, operand::CHCONST(s.substr(k,1))));
+        lowered.append(instruction::WRITEC(i.arg1));
+        k += 1;
+      }
+    }
+  }
+  if (not found) return;
+  set_instructions(std::move(lowered));
+  finalize();
+}
 /// print (for debugging)
 string subroutine::dump() const {
   string s;
@@ -272,28 +569,75 @@ const subroutine& code::get_subroutine(const string &name) const {
   size_t p = names.find(name)->second;
   return subs[p];
 }
+/// get all subroutines
+std::vector<subroutine> & code::get_subroutines() { return subs; }
+const std::vector<subroutine> & code::get_subroutines() const { return subs; }
 /// add subroutine
 void code::add_subroutine(const subroutine &s) {
   subs.push_back(s);
   names.insert(make_pair(s.get_name(), subs.size()-1));
+  pool_strings();
+}
+/// add subroutine, taking ownership of it
+void code::add_subroutine(subroutine &&s) {
+  subs.push_back(std::move(s));
+  names.insert(make_pair(subs.back().get_name(), subs.size()-1));
+  pool_strings();
+}
+/// the "writes" of the last subroutine refer to the string pool
+void code::pool_strings() {
+  instructionList code = subs.back().get_instructions();
+  bool found = false;
+  for (auto &i : code) {
+    if (i.oper != instruction::_WRITES) continue;
+    const string &s = i.arg2.get_name();
+    auto it = stringIndex.find(s);
+    if (it == stringIndex.end()) {
+      it = stringIndex.insert(make_pair(s, strings.size())).first;
+      strings.push_back(operand::STRCONST(s, int(strings.size())));
+    }
+    i.arg2 = strings[it->second];
+    found = true;
+  }
+  if (found) subs.back().set_instructions(std::move(code));
+}
+/// get string pool
+const std::vector<operand> & code::get_strings() const { return strings; }
+/// remove subroutine, and rebuild the index of the ones after it
+void code::remove_subroutine(const string &name) {
+  auto it = names.find(name);
+  if (it == names.end()) return;
+  subs.erase(subs.begin() + it->second);
+  names.clear();
+  for (size_t k = 0; k < subs.size(); ++k)
+    names.insert(make_pair(subs[k].get_name(), k));
+}
+/// lower write-string instructions in all subroutines
+void code::lower_strings() {
+  for (auto &s : subs) s.lower_strings();
+  strings.clear();
+  stringIndex.clear();
 }
 /// print (for debugging)
 string code::dump() const {
   string c;
+  if (not strings.empty()) {
+    c += "strings\n";
+    for (auto &s : strings) c += "  " + s.dump() + " \"" + s.get_name() + "\"\n";
+    c += "endstrings\n\n";
+  }
   for (auto s : subs) c += s.dump();
   return c;
 }
 
 
 ////////////////////////////////////////////////////////////////////
-/// Static methods to manage counters
-int counters::countIF = 0;
-int counters::countWHILE = 0;
-int counters::countTEMP = 0;
-
-string counters::newLabelIF() { return std::to_string(++countIF); }
-string counters::newLabelWHILE() { return std::to_string(++countWHILE); }
-string counters::newTEMP() { return std::to_string(++countTEMP); }
+/// Methods to manage counters
+counters::counters() : countIF(0), countWHILE(0), countTEMP(0) {}
+
+int counters::newLabelIF() { return ++countIF; }
+int counters::newLabelWHILE() { return ++countWHILE; }
+operand counters::newTEMP() { return operand::TEMP(++countTEMP); }
 
 void counters::resetLabelIF() { countIF = 0; }
 void counters::resetLabelWHILE() { countWHILE = 0; }
@@ -31,10 +31,100 @@
 #include <map>
 #include <list>
 #include <vector>
+#include <string>
+
+#include "arena.h"
 
 /// predeclaration
 class instructionList;
 
+////////////////////////////////////////////////////////////////////
+/// Class operand stores an instruction argument in a compact tagged
+/// form: temporaries by number, integer constants by value, labels
+/// by a numeric id (family + number, e.g. "endif" + 3), and names and
+/// float/char/string constants by a pointer to their interned spelling
+/// (so they are printed back exactly as written, and each distinct
+/// string literal of the program is stored once). Once a subroutine is
+/// finalized, jump labels also carry the pc of their target.
+/// Copying an operand never allocates.
+
+class operand {
+public:
+  /// operand kinds
+  typedef enum {_NONE, _TEMP, _NAME, _ICONST, _FCONST, _CHCONST, _LABEL, _STRCONST} Kind;
+
+  /// constructor for an empty operand (e.g. "pushparam" with no argument)
+  operand();
+  /// constructors from the textual form: "" is empty, "%N" is
+  /// temporary N, anything else is a name
+  operand(const std::string &s);
+  operand(const char *s);
+
+  /// ------ specific constructors for each kind -------
+
+  // temporary "%n"
+  static operand TEMP(int n);
+  // variable, parameter or subroutine name
+  static operand NAME(const std::string &s);
+  // integer constant
+  static operand ICONST(int v);
+  // integer constant given by its spelling (kept verbatim if not canonical)
+  static operand ICONST(const std::string &s);
+  // float constant, by its spelling
+  static operand FCONST(const std::string &s);
+  // character constant, by its spelling between quotes (e.g. "a" or "\\n")
+  static operand CHCONST(const std::string &s);
+  // string constant, by its spelling between double quotes (e.g. "hello\\n"),
+  // and its number in the string pool of the program (-1 if not pooled yet)
+  static operand STRCONST(const std::string &s, int n = -1);
+  // label "<prefix><n>" (e.g. LABEL("endif", 3) is "endif3")
+  static operand LABEL(const std::string &prefix, int n);
+  // label given by its whole spelling
+  static operand LABEL(const std::string &s);
+
+  /// kind of operand and shortcuts
+  Kind get_kind() const;
+  bool empty() const;
+  bool is_temp() const;
+  bool is_name() const;
+  bool is_const() const;
+  bool is_label() const;
+  /// temporary number, value of an integer constant, or label number
+  int get_value() const;
+  /// spelling of a name or float/char constant
+  const std::string & get_name() const;
+  /// pc of the label target (-1 if the subroutine is not finalized)
+  int get_target() const;
+  void set_target(int pc);
+
+  /// comparison (by kind and value, so interned names compare by pointer
+  /// and labels by id; label targets are ignored)
+  bool operator==(const operand &o) const;
+  bool operator!=(const operand &o) const;
+  bool operator<(const operand &o) const;
+
+  // print operand
+  std::string dump() const;
+
+private:
+  /// label family and resolved target
+  struct labelRef { int family; int target; };
+
+  Kind kind;
+  int value;
+  union {
+    const std::string *text;   // names and constants
+    labelRef label;            // labels
+  };
+
+  operand(Kind k, int v, const std::string *t);
+  /// return a pointer to the unique stored copy of the given string
+  static const std::string *intern(const std::string &s);
+  /// return the numeric id of a label prefix (registering it if new)
+  static int label_family(const std::string &prefix);
+  static const std::string & label_prefix(int family);
+};
+
 ////////////////////////////////////////////////////////////////////
 /// Class instruction stores a VM instruction code with its operands
 
@@ -45,113 +135,144 @@ public:
                 _ADD, _SUB, _MUL, _DIV, _EQ, _LT, _LE, _NEG, _NOT, _AND, _OR, _FLOAT,
                 _FADD, _FSUB, _FMUL, _FDIV, _FEQ, _FLT, _FLE, _FNEG,
                 _LOAD, _ILOAD, _CHLOAD, _FLOAD, _XLOAD, _LOADX, _ALOAD, _LOADC, _CLOAD,
-                _READI, _READF, _READC, _WRITEI, _WRITEF, _WRITEC, _WRITELN, _NOOP, _INVALID} Operation;
+                _READI, _READF, _READC, _WRITEI, _WRITEF, _WRITEC, _WRITELN, _WRITES, _NOOP, _INVALID} Operation;
   
   /// instruction code
   Operation oper;
   /// arguments
-  std::string arg1, arg2, arg3;
+  operand arg1, arg2, arg3;
   
   /// constructor
   instruction(Operation op,
-              const std::string &a1="", const std::string &a2="", const std::string &a3="");
+              const operand &a1=operand(), const operand &a2=operand(), const operand &a3=operand());
+
+  /// copy and move (explicit, since the destructor is user-declared)
+  instruction(const instruction &) = default;
+  instruction(instruction &&) = default;
+  instruction & operator=(const instruction &) = default;
+  instruction & operator=(instruction &&) = default;
 
   /// destructor
   ~instruction();
 
   // concatenation of instruction+list (or instruction+instruction, via automatic coertion)
   instructionList operator||(const instructionList &lst) const;
+  instructionList operator||(instructionList &&lst) const;
 
   /// ------ specific constructors for each instruction -------
 
   // create new instruction "a1 :"
-  static instruction LABEL(const std::string &a1);
+  static instruction LABEL(const operand &a1);
   // create new instruction "goto a1"
-  static instruction UJUMP(const std::string &a1);
+  static instruction UJUMP(const operand &a1);
   // create new instruction "ifFalse a1 goto a2"
-  static instruction FJUMP(const std::string &a1, const std::string &a2);
+  static instruction FJUMP(const operand &a1, const operand &a2);
   // create new instruction "pushparam a1"
-  static instruction PUSH(const std::string &a1="");
+  static instruction PUSH(const operand &a1=operand());
   // create new instruction "popparam a1"
-  static instruction POP(const std::string &a1="");
+  static instruction POP(const operand &a1=operand());
   // create new instruction "call a1"
-  static instruction CALL(const std::string &a1);
+  static instruction CALL(const operand &a1);
   // create new instruction "return"
   static instruction RETURN();
   // create new instruction "a1 = a2 + a3"
-  static instruction ADD(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction ADD(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 - a3"
-  static instruction SUB(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction SUB(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 * a3"
-  static instruction MUL(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction MUL(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 / a3"
-  static instruction DIV(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction DIV(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 == a3"
-  static instruction EQ(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction EQ(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 < a3"
-  static instruction LT(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction LT(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 <= a3"
-  static instruction LE(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction LE(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 and a3"
-  static instruction AND(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction AND(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 or a3"
-  static instruction OR(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction OR(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 +. a3"
-  static instruction FADD(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FADD(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 -. a3"
-  static instruction FSUB(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FSUB(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 *. a3"
-  static instruction FMUL(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FMUL(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 /. a3"
-  static instruction FDIV(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FDIV(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 ==. a3"
-  static instruction FEQ(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FEQ(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 <. a3"
-  static instruction FLT(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FLT(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2 <=. a3"
-  static instruction FLE(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FLE(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = not a2"
-  static instruction NOT(const std::string &a1, const std::string &a2);
+  static instruction NOT(const operand &a1, const operand &a2);
   // create new instruction "a1 = - a2"
-  static instruction NEG(const std::string &a1, const std::string &a2);
+  static instruction NEG(const operand &a1, const operand &a2);
   // create new instruction "a1 = -. a2"
-  static instruction FNEG(const std::string &a1, const std::string &a2);
+  static instruction FNEG(const operand &a1, const operand &a2);
   // create new instruction "a1 = float a2"
-  static instruction FLOAT(const std::string &a1, const std::string &a2);  
+  static instruction FLOAT(const operand &a1, const operand &a2);  
   // create new instruction "a1 = a2"
-  static instruction LOAD(const std::string &a1, const std::string &a2);
+  static instruction LOAD(const operand &a1, const operand &a2);
   // create new instruction "a1 = a2" (where a2 is an integer constant)
-  static instruction ILOAD(const std::string &a1, const std::string &a2);
+  static instruction ILOAD(const operand &a1, const operand &a2);
   // create new instruction "a1 = a2" (where a2 is a character constant)
-  static instruction CHLOAD(const std::string &a1, const std::string &a2);
+  static instruction CHLOAD(const operand &a1, const operand &a2);
   // create new instruction "a1 = a2" (where a2 is a float constant)
-  static instruction FLOAD(const std::string &a1, const std::string &a2);
+  static instruction FLOAD(const operand &a1, const operand &a2);
   // create new instruction "a1[a2] = a3" 
-  static instruction XLOAD(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction XLOAD(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = a2[a3]" 
-  static instruction LOADX(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction LOADX(const operand &a1, const operand &a2, const operand &a3);
   // create new instruction "a1 = &a2" 
-  static instruction ALOAD(const std::string &a1, const std::string &a2);
+  static instruction ALOAD(const operand &a1, const operand &a2);
   // create new instruction "a1 = *a2" 
-  static instruction LOADC(const std::string &a1, const std::string &a2);
+  static instruction LOADC(const operand &a1, const operand &a2);
   // create new instruction "*a1 = a2" 
-  static instruction CLOAD(const std::string &a1, const std::string &a2);
+  static instruction CLOAD(const operand &a1, const operand &a2);
   // create new instruction "readi a1" 
-  static instruction READI(const std::string &a1);
+  static instruction READI(const operand &a1);
   // create new instruction "readf a1" 
-  static instruction READF(const std::string &a1);
+  static instruction READF(const operand &a1);
   // create new instruction "readc a1" 
-  static instruction READC(const std::string &a1);
+  static instruction READC(const operand &a1);
   // create new instruction "writei a1" 
-  static instruction WRITEI(const std::string &a1); 
+  static instruction WRITEI(const operand &a1); 
   // create new instruction "writef a1" 
-  static instruction WRITEF(const std::string &a1);
+  static instruction WRITEF(const operand &a1);
   // create new instruction "writec a1" 
-  static instruction WRITEC(const std::string &a1);
+  static instruction WRITEC(const operand &a1);
   // create new instruction "writeln" 
   static instruction WRITELN();
+  // create new instruction "writes a2" (where a2 is a string constant;
+  // a1 is the temporary used when it is lowered to "writec" per char,
+  // which "writes" itself neither sets nor reads)
+  static instruction WRITES(const operand &a1, const operand &a2);
   // create new instruction "noop" (not really needed) 
   static instruction NOOP();
+
+  /// ------ data-flow information (used by the optimizer) -------
+
+  // operand written by the instruction (nullptr if none)
+  operand * get_def();
+  const operand * get_def() const;
+  // operands read by the instruction (stored in u, returns how many).
+  // The array of an ALOAD (whose address is taken, not its value) is not a use.
+  int get_uses(operand *u[3]);
+  int get_uses(const operand *u[3]) const;
+  // instruction is a jump, or ends a basic block (jump or return)
+  bool is_jump() const;
+  bool ends_block() const;
+  // instruction reads or writes memory through an array or a pointer
+  // (calls may do both, on arrays passed by address)
+  bool reads_memory() const;
+  bool writes_memory() const;
+  // instruction does more than computing its def (I/O, memory
+  // writes, calls, parameter passing or control flow)
+  bool has_side_effects() const;
   
   // print instruction
   std::string dump() const;   
@@ -159,19 +280,34 @@ public:
 
 
 ////////////////////////////////////////////////////////////////////
-/// Class instructionList stores a list of instructions
+/// Class instructionList stores a list of instructions (in the
+/// current arena, if any; see arena.h)
 
-class instructionList : public std::vector<instruction> {
+class instructionList : public std::vector<instruction, arenaAllocator<instruction>> {
 public:
   // constructor
   instructionList();
   // constructor from a single instruction
   instructionList(const instruction &);
+  // copy and move (explicit, since the destructor is user-declared)
+  instructionList(const instructionList &) = default;
+  instructionList(instructionList &&) = default;
+  instructionList & operator=(const instructionList &) = default;
+  instructionList & operator=(instructionList &&) = default;
   // destructor
   ~instructionList();
 
-  // concatenation of lists (or list+instruction, via automatic coertion)
-  instructionList operator||(const instructionList &lst) const;
+  // concatenation of lists (or list+instruction, via automatic coertion).
+  // When the left operand is a temporary its storage is reused, so a chain
+  // like  a || b || c  only copies 'a' once and appends the rest in place.
+  instructionList operator||(const instructionList &lst) const &;
+  instructionList operator||(const instructionList &lst) &&;
+  instructionList operator||(instructionList &&lst) &&;
+
+  // append a list (or a single instruction) at the end of this one, in place
+  instructionList & append(const instructionList &lst);
+  instructionList & append(instructionList &&lst);
+  instructionList & append(const instruction &inst);
 
   // print instructionList
   std::string dump() const;   
@@ -204,8 +340,8 @@ private:
   std::string name;
   /// instructions
   instructionList instructions;
-  /// map label name -> position in instructions
-  std::map<std::string, size_t> labels;
+  /// map label -> position in instructions
+  std::map<operand, size_t> labels;
 
 public:
   /// list of local variables
@@ -216,6 +352,11 @@ public:
   /// constructor and destructor
   subroutine(const std::string &sname);
   ~subroutine();
+  /// copy and move (explicit, since the destructor is user-declared)
+  subroutine(const subroutine &) = default;
+  subroutine(subroutine &&) = default;
+  subroutine & operator=(const subroutine &) = default;
+  subroutine & operator=(subroutine &&) = default;
 
   /// get subroutine name
   std::string get_name() const;
@@ -231,11 +372,21 @@ public:
   void add_instructions(const instructionList &lins);
   /// set instruction list (overwritting current instructions)
   void set_instructions(const instructionList &lins);
+  /// set instruction list, taking ownership of the given one
+  void set_instructions(instructionList &&lins);
   
   /// get instruction at given program counter in subroutine
   instruction get_instruction_at(size_t pc) const;
+  /// get all the instructions of the subroutine
+  const instructionList & get_instructions() const;
   /// get program counter in subroutine for given label
-  size_t get_label_pc(std::string &lab) const;
+  size_t get_label_pc(const operand &lab) const;
+  /// resolve jumps: store in each UJUMP/FJUMP label the pc of its
+  /// target, so they can be followed without any lookup
+  void finalize();
+  /// lower each "writes" to the "writec"/"writeln" sequence that
+  /// prints its string (tvm has no write-string instruction)
+  void lower_strings();
 
   // print subroutine (params, vars, and instructions)
   std::string dump() const;
@@ -250,18 +401,41 @@ private:
   std::vector<subroutine> subs;
   /// index to access subroutines by name
   std::map<std::string, size_t> names;
+  /// string pool: the literals written by "writes", each one once, and
+  /// the number of each one in the pool
+  std::vector<operand> strings;
+  std::map<std::string, size_t> stringIndex;
+
+  /// add the literals of the last subroutine to the pool
+  void pool_strings();
   
 public:
   /// constructor and destructor
   code();
   ~code();
+  /// copy and move (explicit, since the destructor is user-declared)
+  code(const code &) = default;
+  code(code &&) = default;
+  code & operator=(const code &) = default;
+  code & operator=(code &&) = default;
 
   /// get most recently added subroutine (i.e. the one currently being processed)
   subroutine& get_last_subroutine();
   /// get subroutine by name
   const subroutine& get_subroutine(const std::string &name) const;
+  /// get all subroutines
+  std::vector<subroutine> & get_subroutines();
+  const std::vector<subroutine> & get_subroutines() const;
   /// add new subroutine
   void add_subroutine(const subroutine &s);
+  void add_subroutine(subroutine &&s);
+  /// remove a subroutine (the others keep their order)
+  void remove_subroutine(const std::string &name);
+  /// string pool (the "writes" of the subroutines refer to its entries)
+  const std::vector<operand> & get_strings() const;
+  /// lower the "writes" of all the subroutines (see subroutine::lower_strings),
+  /// which leaves the string pool empty
+  void lower_strings();
 
   // print code (all info for all subroutines)
   std::string dump() const;
@@ -269,28 +443,35 @@ public:
 
 
 ////////////////////////////////////////////////////////////////////
-/// Class counters manages temporal and labels counters
+/// Class counters manages temporal and labels counters. Each code
+/// generator owns its own counters (one set per function being
+/// generated), so independent functions or programs can be generated
+/// concurrently in the same process.
 
 class counters {
 private:
-  static int countIF;
-  static int countWHILE;
-  static int countTEMP;
+  int countIF;
+  int countWHILE;
+  int countTEMP;
 
 public:
-  // return id for new label or temp (id is a number, but returned as string
-  // to ease concatenation with other literals (e.g. "labelIF" + "4" -> "LabelIF4")
-  static std::string newLabelIF();
-  static std::string newLabelWHILE();
-  static std::string newTEMP();
+  // constructor (all counters start at zero)
+  counters();
+
+  // return number for new label (to be combined with a prefix,
+  // e.g. operand::LABEL("endif", 4) -> "endif4")
+  int newLabelIF();
+  int newLabelWHILE();
+  // return a new temporary operand ("%N")
+  operand newTEMP();
   
   // reset individual counters 
-  static void resetLabelIF();
-  static void resetLabelWHILE();
-  static void resetTEMP();
+  void resetLabelIF();
+  void resetLabelWHILE();
+  void resetTEMP();
   
   // reset label counters (IF and WHILE)
-  static void resetLabels();
+  void resetLabels();
   // reset all counters (IF, WHILE, and TEMP)
-  static void reset();
+  void reset();
 };
@@ -0,0 +1,424 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    constprop - Constant folding and propagation on SSA form
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "constprop.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+////////////////////////////////////////////////////////////////////
+/// Lattice values
+
+constantFolding::constant::constant(State s) : state(s), i(0), f(0) {}
+
+constantFolding::constant constantFolding::constant::INT_VALUE(int v) {
+  constant c(INT);
+  c.i = v;
+  return c;
+}
+
+constantFolding::constant constantFolding::constant::FLOAT_VALUE(float v) {
+  constant c(FLOAT);
+  c.f = v;
+  return c;
+}
+
+bool constantFolding::constant::is_known() const {
+  return state != TOP and state != BOTTOM;
+}
+
+// floats are compared bit by bit, so 0.0 and -0.0 are different
+bool constantFolding::constant::operator==(const constant &c) const {
+  if (state != c.state) return false;
+  if (state == FLOAT) return std::memcmp(&f, &c.f, sizeof(f)) == 0;
+  return state != INT and state != CHAR ? true : i == c.i;
+}
+
+bool constantFolding::constant::operator!=(const constant &c) const {
+  return not (*this == c);
+}
+
+constantFolding::constant constantFolding::meet(const constant &a, const constant &b) {
+  if (a.state == constant::TOP) return b;
+  if (b.state == constant::TOP) return a;
+  return a == b ? a : constant(constant::BOTTOM);
+}
+
+/// shortest literal that tvm reads back as the same float (empty if
+/// it would need an exponent)
+std::string constantFolding::float_literal(float f) {
+  if (not std::isfinite(f)) return "";
+  char buf[64];
+  for (int p = 1; p <= 9; ++p) {
+    std::snprintf(buf, sizeof(buf), "%.*g", p, double(f));
+    if (std::strchr(buf, 'e') != nullptr) continue;
+    if (std::strtof(buf, nullptr) != f) continue;
+    std::string s(buf);
+    if (s.find('.') == std::string::npos) s += ".0";
+    return s;
+  }
+  return "";
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Propagation
+
+constantFolding::constantFolding(ssaForm &ssa) : ssa(ssa), cfg(ssa.get_cfg()) {}
+
+/// value of an operand: the values that are not defined in the code
+/// (parameters, uninitialized variables) are not constant
+constantFolding::constant constantFolding::value_of(const operand &o) const {
+  auto it = values.find(o);
+  return it == values.end() ? constant(constant::BOTTOM) : it->second;
+}
+
+bool constantFolding::lower(const operand &name, const constant &c) {
+  auto it = values.find(name);
+  if (it == values.end()) return false;
+  constant m = meet(it->second, c);
+  if (m == it->second) return false;
+  it->second = m;
+  return true;
+}
+
+bool constantFolding::mark_edge(std::size_t from, std::size_t to) {
+  if (not executableEdges.insert(std::make_pair(from, to)).second) return false;
+  executable[to] = true;
+  return true;
+}
+
+namespace {
+
+  int char_code(const std::string &s) {
+    if (s.size() == 1) return (unsigned char)s[0];
+    if (s.size() != 2 or s[0] != '\\') return -1;
+    switch (s[1]) {
+    case 'b':  return '\b';
+    case 't':  return '\t';
+    case 'n':  return '\n';
+    case 'f':  return '\f';
+    case 'r':  return '\r';
+    case '"':  return '"';
+    case '\'': return '\'';
+    case '\\': return '\\';
+    default:   return -1;
+    }
+  }
+
+  // 32 bit arithmetic wrapping around, as in tvm
+  int wrap(long long v) { return int((unsigned int)(v)); }
+
+}
+
+/// value computed by an instruction, from the values of its operands
+constantFolding::constant constantFolding::evaluate(const instruction &i) const {
+  switch (i.oper) {
+  case instruction::_ILOAD:
+    if (i.arg2.dump() != std::to_string(i.arg2.get_value())) return constant(constant::BOTTOM);
+    return constant::INT_VALUE(i.arg2.get_value());
+  case instruction::_FLOAD:
+    return constant::FLOAT_VALUE(std::strtof(i.arg2.dump().c_str(), nullptr));
+  case instruction::_CHLOAD: {
+    int code = char_code(i.arg2.dump());
+    if (code < 0) return constant(constant::BOTTOM);
+    constant c(constant::CHAR);
+    c.i = code;
+    c.literal = i.arg2;
+    return c;
+  }
+  case instruction::_LOAD:
+    return value_of(i.arg2);
+  default:
+    break;
+  }
+
+  // operations: unknown if an operand is unknown yet, not constant
+  // if an operand is not constant
+  const operand *u[3];
+  int n = i.get_uses(u);
+  if (n == 0 or i.get_def() == nullptr) return constant(constant::BOTTOM);
+  constant a = value_of(*u[0]), b = n > 1 ? value_of(*u[1]) : a;
+  if (a.state == constant::BOTTOM or b.state == constant::BOTTOM) return constant(constant::BOTTOM);
+  if (a.state == constant::TOP or b.state == constant::TOP) return constant(constant::TOP);
+
+  bool ints = a.state != constant::FLOAT and b.state != constant::FLOAT;
+  bool floats = a.state == constant::FLOAT and b.state == constant::FLOAT;
+  switch (i.oper) {
+  case instruction::_ADD: if (ints) return constant::INT_VALUE(wrap((long long)a.i + b.i)); break;
+  case instruction::_SUB: if (ints) return constant::INT_VALUE(wrap((long long)a.i - b.i)); break;
+  case instruction::_MUL: if (ints) return constant::INT_VALUE(wrap((long long)a.i * b.i)); break;
+  case instruction::_DIV:
+    // division by zero (and the overflowing INT_MIN/-1) fail at run time
+    if (ints and b.i != 0 and not (a.i == INT_MIN and b.i == -1))
+      return constant::INT_VALUE(a.i / b.i);
+    break;
+  case instruction::_EQ:  if (ints) return constant::INT_VALUE(a.i == b.i); break;
+  case instruction::_LT:  if (ints) return constant::INT_VALUE(a.i < b.i); break;
+  case instruction::_LE:  if (ints) return constant::INT_VALUE(a.i <= b.i); break;
+  case instruction::_AND: if (ints) return constant::INT_VALUE(a.i != 0 and b.i != 0); break;
+  case instruction::_OR:  if (ints) return constant::INT_VALUE(a.i != 0 or b.i != 0); break;
+  case instruction::_NOT: if (ints) return constant::INT_VALUE(a.i == 0); break;
+  case instruction::_NEG: if (ints) return constant::INT_VALUE(wrap(-(long long)a.i)); break;
+  case instruction::_FLOAT:
+    if (a.state == constant::INT) return constant::FLOAT_VALUE(float(a.i));
+    break;
+  case instruction::_FADD: if (floats) return constant::FLOAT_VALUE(a.f + b.f); break;
+  case instruction::_FSUB: if (floats) return constant::FLOAT_VALUE(a.f - b.f); break;
+  case instruction::_FMUL: if (floats) return constant::FLOAT_VALUE(a.f * b.f); break;
+  case instruction::_FDIV: if (floats and b.f != 0) return constant::FLOAT_VALUE(a.f / b.f); break;
+  case instruction::_FEQ:  if (floats) return constant::INT_VALUE(a.f == b.f); break;
+  case instruction::_FLT:  if (floats) return constant::INT_VALUE(a.f < b.f); break;
+  case instruction::_FLE:  if (floats) return constant::INT_VALUE(a.f <= b.f); break;
+  case instruction::_FNEG: if (floats) return constant::FLOAT_VALUE(-a.f); break;
+  default: break;
+  }
+  return constant(constant::BOTTOM);
+}
+
+/// evaluate the executable blocks until no value changes, following
+/// only the edges that can be taken with the values found
+void constantFolding::propagate() {
+  const std::vector<std::size_t> &rpo = cfg.get_reverse_postorder();
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto b : rpo) {
+      if (not executable[b]) continue;
+      basicBlock &blk = cfg.get_block(b);
+      for (auto &p : ssa.get_phis(b)) {
+        constant c;
+        for (std::size_t j = 0; j < p.args.size(); ++j)
+          if (executableEdges.count(std::make_pair(blk.preds[j], b)))
+            c = meet(c, value_of(p.args[j]));
+        changed = lower(p.def, c) or changed;
+      }
+      for (auto &i : blk.instructions) {
+        const operand *d = i.get_def();
+        if (d != nullptr and ssa.is_value(*d))
+          changed = lower(*d, evaluate(i)) or changed;
+      }
+      const instruction *t = blk.get_terminator();
+      if (t != nullptr and t->oper == instruction::_FJUMP) {
+        constant c = value_of(t->arg1);
+        if (c.state == constant::TOP) continue;
+        if (c.is_known()) {
+          int target = c.i == 0 ? cfg.get_block_of_label(t->arg2) : blk.fallthrough;
+          if (target >= 0) changed = mark_edge(b, target) or changed;
+          continue;
+        }
+      }
+      for (auto s : blk.succs)
+        changed = mark_edge(b, s) or changed;
+    }
+
+    // a condition still unknown here is never computed: take both ways
+    if (not changed)
+      for (auto b : rpo) {
+        const instruction *t = cfg.get_block(b).get_terminator();
+        if (executable[b] and t != nullptr and t->oper == instruction::_FJUMP and
+            value_of(t->arg1).state == constant::TOP)
+          for (auto s : cfg.get_block(b).succs)
+            changed = mark_edge(b, s) or changed;
+      }
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Rewriting
+
+/// replace an instruction computing a constant by loads of it
+bool constantFolding::fold_instruction(instruction &i, instructionList &code) {
+  if (i.oper == instruction::_ILOAD or i.oper == instruction::_FLOAD or
+      i.oper == instruction::_CHLOAD)
+    return false;
+  const operand *d = i.get_def();
+  if (d == nullptr or not ssa.is_value(*d)) return false;
+  constant c = value_of(*d);
+  operand dest = *d;
+
+  if (c.state == constant::CHAR) {
+    code.append(instruction::CHLOAD(dest, c.literal));
+    return true;
+  }
+  if (c.state == constant::INT) {
+    if (c.i >= 0) {
+      code.append(instruction::ILOAD(dest, operand::ICONST(c.i)));
+      return true;
+    }
+    // t-code has no negative literals
+    if (i.oper == instruction::_NEG or c.i == INT_MIN) return false;
+    operand t = ssa.new_temp();
+    code.append(instruction::ILOAD(t, operand::ICONST(-c.i)));
+    code.append(instruction::NEG(dest, t));
+    return true;
+  }
+  if (c.state == constant::FLOAT) {
+    std::string lit = float_literal(std::fabs(c.f));
+    if (lit.empty()) return false;
+    if (not std::signbit(c.f)) {
+      code.append(instruction::FLOAD(dest, operand::FCONST(lit)));
+      return true;
+    }
+    if (i.oper == instruction::_FNEG) return false;
+    operand t = ssa.new_temp();
+    code.append(instruction::FLOAD(t, operand::FCONST(lit)));
+    code.append(instruction::FNEG(dest, t));
+    return true;
+  }
+  return false;
+}
+
+/// jumps on constant conditions, and blocks that are never executed
+std::size_t constantFolding::fold_branches() {
+  std::size_t count = 0;
+  std::vector<std::size_t> rpo = cfg.get_reverse_postorder();
+  for (auto b : rpo) {
+    basicBlock &blk = cfg.get_block(b);
+    if (not executable[b]) {
+      // only the label is kept, for the jumps of other unused blocks
+      std::size_t k = blk.instructions.empty() or
+                      blk.instructions[0].oper != instruction::_LABEL ? 0 : 1;
+      count += blk.instructions.size() - k;
+      blk.instructions.erase(blk.instructions.begin() + k, blk.instructions.end());
+      ssa.get_phis(b).clear();
+      while (not blk.succs.empty())
+        ssa.remove_edge(b, blk.succs.back());
+      blk.fallthrough = -1;
+      continue;
+    }
+    instruction *t = blk.get_terminator();
+    if (t == nullptr or t->oper != instruction::_FJUMP) continue;
+    constant c = value_of(t->arg1);
+    int target = cfg.get_block_of_label(t->arg2);
+    if (not c.is_known() or target < 0) continue;
+    int next = blk.fallthrough;
+    if (c.i == 0) {
+      *t = instruction::UJUMP(t->arg2);
+      if (next >= 0 and next != target) ssa.remove_edge(b, next);
+      blk.fallthrough = -1;
+    }
+    else {
+      blk.instructions.pop_back();
+      if (next != target) ssa.remove_edge(b, target);
+    }
+    ++count;
+  }
+  cfg.update();
+  return count;
+}
+
+/// constants (loaded, or negated after the load) whose value is not
+/// used any more
+std::size_t constantFolding::remove_unused_loads() {
+  std::map<operand, int> uses;
+  for (std::size_t b = 0; b < cfg.get_num_blocks(); ++b) {
+    for (auto &p : ssa.get_phis(b))
+      for (auto &a : p.args) ++uses[a];
+    for (auto &i : cfg.get_block(b).instructions) {
+      const operand *u[3];
+      int n = i.get_uses(u);
+      for (int k = 0; k < n; ++k) ++uses[*u[k]];
+    }
+  }
+
+  // backwards, so the load of a removed NEG is removed too
+  std::size_t count = 0;
+  for (auto b : cfg.get_reverse_postorder()) {
+    instructionList &code = cfg.get_block(b).instructions;
+    std::vector<bool> removed(code.size(), false);
+    for (std::size_t k = code.size(); k-- > 0; ) {
+      instruction &i = code[k];
+      bool load = i.oper == instruction::_ILOAD or i.oper == instruction::_FLOAD or
+                  i.oper == instruction::_CHLOAD;
+      bool neg = (i.oper == instruction::_NEG or i.oper == instruction::_FNEG) and
+                 value_of(i.arg1).is_known();
+      if (not (load or neg) or not ssa.is_value(i.arg1) or uses[i.arg1] > 0) continue;
+      if (neg) --uses[i.arg2];
+      removed[k] = true;
+      ++count;
+    }
+    std::size_t last = 0;
+    for (std::size_t k = 0; k < code.size(); ++k)
+      if (not removed[k]) code[last++] = code[k];
+    code.erase(code.begin() + last, code.end());
+  }
+  return count;
+}
+
+std::size_t constantFolding::run() {
+  std::size_t nb = cfg.get_num_blocks();
+  values.clear();
+  for (std::size_t b = 0; b < nb; ++b) {
+    for (auto &p : ssa.get_phis(b))
+      values[p.def] = constant();
+    for (auto &i : cfg.get_block(b).instructions) {
+      const operand *d = i.get_def();
+      if (d != nullptr and ssa.is_value(*d)) values[*d] = constant();
+    }
+  }
+  executable.assign(nb, false);
+  executable[0] = true;
+  executableEdges.clear();
+  propagate();
+
+  std::size_t count = 0;
+  for (auto b : cfg.get_reverse_postorder()) {
+    if (not executable[b]) continue;
+    basicBlock &blk = cfg.get_block(b);
+    std::vector<ssaForm::phi> &phis = ssa.get_phis(b);
+    instructionList code;
+    code.reserve(blk.instructions.size() + phis.size());
+    std::size_t k = 0;
+    if (not blk.instructions.empty() and blk.instructions[0].oper == instruction::_LABEL)
+      code.append(blk.instructions[k++]);
+
+    // constant phis become loads at the start of the block
+    std::vector<ssaForm::phi> kept;
+    for (auto &p : phis) {
+      instruction load = instruction::LOAD(p.def, p.def);
+      if (not value_of(p.def).is_known() or not fold_instruction(load, code))
+        kept.push_back(p);
+    }
+    phis.swap(kept);
+
+    for (; k < blk.instructions.size(); ++k)
+      if (fold_instruction(blk.instructions[k], code)) ++count;
+      else code.append(blk.instructions[k]);
+    blk.instructions = std::move(code);
+  }
+  count += fold_branches();
+  count += remove_unused_loads();
+  return count;
+}
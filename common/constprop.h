@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    constprop - Constant folding and propagation on SSA form
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+#include "ssa.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class constantFolding finds the SSA values that are constant
+/// (sparse conditional constant propagation: only the blocks that can
+/// be reached with the constants found so far are evaluated), and
+/// rewrites the subroutine with them:
+///   - an instruction computing a constant becomes one load (or a
+///     load and a NEG/FNEG, for negative numbers)
+///   - "ifFalse" on a constant becomes a "goto" or disappears, and
+///     the blocks that can not be reached any more are emptied
+///   - loads of constants that are no longer used are removed
+///
+/// Values are computed as tvm does: 32 bit integers that wrap
+/// around, division truncating towards zero, single precision floats,
+/// and 0/1 for booleans (so the LE+NOT that encode '>' fold too).
+/// Divisions by zero, and results that can not be written as a
+/// t-code literal, are left to run time.
+
+class constantFolding {
+public:
+  /// constructor
+  constantFolding(ssaForm &ssa);
+
+  /// fold the constants, and return the number of instructions
+  /// changed or removed
+  std::size_t run();
+
+private:
+  /// Class constant is a value of the lattice: still unknown (top),
+  /// a known int/char/float constant, or not constant (bottom).
+  /// Chars keep their literal, and their code in 'i'.
+  class constant {
+  public:
+    typedef enum {TOP, INT, CHAR, FLOAT, BOTTOM} State;
+    State state;
+    int i;
+    float f;
+    operand literal;
+
+    constant(State s = TOP);
+    static constant INT_VALUE(int v);
+    static constant FLOAT_VALUE(float v);
+    bool is_known() const;
+    bool operator==(const constant &c) const;
+    bool operator!=(const constant &c) const;
+  };
+
+  ssaForm &ssa;
+  controlFlowGraph &cfg;
+  std::map<operand, constant> values;
+  std::vector<bool> executable;
+  std::set<std::pair<std::size_t, std::size_t>> executableEdges;
+
+  constant value_of(const operand &o) const;
+  bool lower(const operand &name, const constant &c);
+  bool mark_edge(std::size_t from, std::size_t to);
+  constant evaluate(const instruction &i) const;
+  void propagate();
+  bool fold_instruction(instruction &i, instructionList &code);
+  std::size_t fold_branches();
+  std::size_t remove_unused_loads();
+
+  static constant meet(const constant &a, const constant &b);
+  static std::string float_literal(float f);
+};
@@ -0,0 +1,153 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    copyprop - Copy propagation on SSA form
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "copyprop.h"
+
+#include <set>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'copyPropagation'
+
+copyPropagation::copyPropagation(ssaForm &ssa) : ssa(ssa), cfg(ssa.get_cfg()) {}
+
+/// value copied (through any number of copies) into o. If names are
+/// not allowed, the last temporary of the chain is returned instead.
+operand copyPropagation::original(const operand &o, bool names) const {
+  operand cur = o;
+  for (std::size_t steps = 0; steps <= source.size(); ++steps) {
+    auto it = source.find(cur);
+    if (it == source.end() or (not names and not it->second.is_temp())) return cur;
+    cur = it->second;
+  }
+  return o;  // phis copying each other in a loop: leave them alone
+}
+
+/// copies, and phis with a single value (from the reachable blocks)
+void copyPropagation::find_copies() {
+  source.clear();
+  for (auto b : cfg.get_reverse_postorder()) {
+    const basicBlock &blk = cfg.get_block(b);
+    for (auto &p : ssa.get_phis(b)) {
+      operand single;
+      bool unique = true;
+      for (std::size_t j = 0; j < p.args.size() and unique; ++j) {
+        if (not cfg.is_reachable(blk.preds[j]) or p.args[j] == p.def) continue;
+        if (single.empty()) single = p.args[j];
+        else unique = single == p.args[j];
+      }
+      if (unique and not single.empty() and ssa.is_value(single))
+        source[p.def] = single;
+    }
+    for (auto &i : blk.instructions)
+      if (i.oper == instruction::_LOAD and ssa.is_value(i.arg1) and
+          ssa.is_value(i.arg2) and i.arg1 != i.arg2)
+        source[i.arg1] = i.arg2;
+  }
+}
+
+/// returns the number of copies with some use replaced (the copies
+/// already propagated by an earlier run have no uses left)
+std::size_t copyPropagation::replace_uses() {
+  std::set<operand> replaced;
+  auto replace = [&](operand &o, bool names) {
+    operand orig = original(o, names);
+    if (orig == o) return;
+    replaced.insert(o);
+    o = orig;
+  };
+  for (auto b : cfg.get_reverse_postorder()) {
+    for (auto &p : ssa.get_phis(b))
+      for (auto &a : p.args)
+        replace(a, true);
+    for (auto &i : cfg.get_block(b).instructions) {
+      operand *u[3];
+      int n = i.get_uses(u);
+      for (int k = 0; k < n; ++k) {
+        bool address = (u[k] == &i.arg1 and (i.oper == instruction::_XLOAD or
+                                             i.oper == instruction::_CLOAD)) or
+                       (u[k] == &i.arg2 and (i.oper == instruction::_LOADX or
+                                             i.oper == instruction::_LOADC));
+        replace(*u[k], not address);
+      }
+    }
+  }
+  return replaced.size();
+}
+
+/// "%t = ...; name = %t" computes the value straight into the name,
+/// when the name is not renamed and %t has no other use
+std::size_t copyPropagation::store_results() {
+  std::map<operand, int> uses;
+  for (auto b : cfg.get_reverse_postorder()) {
+    for (auto &p : ssa.get_phis(b))
+      for (auto &a : p.args) ++uses[a];
+    for (auto &i : cfg.get_block(b).instructions) {
+      const operand *u[3];
+      int n = i.get_uses(u);
+      for (int k = 0; k < n; ++k) ++uses[*u[k]];
+    }
+  }
+
+  std::size_t count = 0;
+  for (auto b : cfg.get_reverse_postorder()) {
+    instructionList &code = cfg.get_block(b).instructions;
+    std::vector<bool> removed(code.size(), false);
+    for (std::size_t k = 0; k < code.size(); ++k) {
+      const instruction &copy = code[k];
+      if (copy.oper != instruction::_LOAD or not copy.arg1.is_name() or
+          ssa.is_value(copy.arg1) or not copy.arg2.is_temp() or uses[copy.arg2] != 1)
+        continue;
+      // find the definition, going back while the name is not mentioned
+      for (std::size_t j = k; j-- > 0; ) {
+        instruction &def = code[j];
+        if (def.get_def() == &def.arg1 and def.arg1 == copy.arg2) {
+          def.arg1 = copy.arg1;
+          removed[k] = true;
+          ++count;
+          break;
+        }
+        if (def.arg1 == copy.arg1 or def.arg2 == copy.arg1 or def.arg3 == copy.arg1 or
+            def.oper == instruction::_CALL)
+          break;
+      }
+    }
+    std::size_t last = 0;
+    for (std::size_t k = 0; k < code.size(); ++k)
+      if (not removed[k]) code[last++] = code[k];
+    code.erase(code.begin() + last, code.end());
+  }
+  return count;
+}
+
+std::size_t copyPropagation::run() {
+  find_copies();
+  std::size_t count = replace_uses();
+  return count + store_results();
+}
@@ -0,0 +1,71 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    copyprop - Copy propagation on SSA form
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+#include "ssa.h"
+
+#include <map>
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class copyPropagation replaces the uses of the SSA values that
+/// are copies of other values ("LOAD d, s", and phis whose arguments
+/// are all the same value) by the original value, so the copies are
+/// left unused (for deadCodeElimination to remove them).
+///
+/// A variable name is never put where tvm expects the address of an
+/// array (XLOAD/LOADX/ALOAD bases, LOADC/CLOAD addresses), since
+/// there a name means a local array.
+///
+/// It also writes straight into the names that are not renamed
+/// ("_result"): "%t = a + b; _result = %t" becomes "_result = a + b"
+/// when %t has no other use.
+
+class copyPropagation {
+public:
+  /// constructor
+  copyPropagation(ssaForm &ssa);
+
+  /// propagate the copies, and return the number of copies whose
+  /// uses were replaced (or that were removed)
+  std::size_t run();
+
+private:
+  ssaForm &ssa;
+  controlFlowGraph &cfg;
+  /// value copied by each copy
+  std::map<operand, operand> source;
+
+  operand original(const operand &o, bool names) const;
+  void find_copies();
+  std::size_t replace_uses();
+  std::size_t store_results();
+};
@@ -0,0 +1,118 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    deadcode - Dead code elimination on SSA form
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "deadcode.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'deadCodeElimination'
+
+deadCodeElimination::deadCodeElimination(ssaForm &ssa) : ssa(ssa), cfg(ssa.get_cfg()) {}
+
+std::size_t deadCodeElimination::run() {
+  const std::vector<std::size_t> &rpo = cfg.get_reverse_postorder();
+
+  // definition of each value: block and instruction (-1-k for phi k)
+  std::map<operand, std::pair<std::size_t, int>> defs;
+  for (auto b : rpo) {
+    const std::vector<ssaForm::phi> &phis = ssa.get_phis(b);
+    for (std::size_t k = 0; k < phis.size(); ++k)
+      defs[phis[k].def] = std::make_pair(b, -1 - int(k));
+    const instructionList &code = cfg.get_block(b).instructions;
+    for (std::size_t k = 0; k < code.size(); ++k) {
+      const operand *d = code[k].get_def();
+      if (d != nullptr and ssa.is_value(*d)) defs[*d] = std::make_pair(b, int(k));
+    }
+  }
+
+  auto removable = [&](const instruction &i) -> bool {
+    const operand *d = i.get_def();
+    if (i.has_side_effects() or d == nullptr or not ssa.is_value(*d)) return false;
+    if (i.oper != instruction::_DIV) return true;
+    auto it = defs.find(i.arg3);
+    if (it == defs.end() or it->second.second < 0) return false;
+    const instruction &div = cfg.get_block(it->second.first).instructions[it->second.second];
+    return div.oper == instruction::_ILOAD and div.arg2.get_value() != 0;
+  };
+
+  // mark the values used by the instructions that must stay, and
+  // then the values used to compute them
+  std::set<operand> live;
+  std::vector<operand> work;
+  auto use = [&](const operand &o) {
+    if (ssa.is_value(o) and live.insert(o).second) work.push_back(o);
+  };
+  std::vector<std::vector<bool>> needed(cfg.get_num_blocks());
+  for (auto b : rpo)
+    for (auto &i : cfg.get_block(b).instructions) {
+      needed[b].push_back(not removable(i));
+      if (needed[b].back()) {
+        const operand *u[3];
+        int n = i.get_uses(u);
+        for (int k = 0; k < n; ++k) use(*u[k]);
+      }
+    }
+  while (not work.empty()) {
+    operand v = work.back();
+    work.pop_back();
+    auto it = defs.find(v);
+    if (it == defs.end()) continue;
+    std::size_t b = it->second.first;
+    int k = it->second.second;
+    if (k < 0) {
+      for (auto &a : ssa.get_phis(b)[-1 - k].args) use(a);
+      continue;
+    }
+    const operand *u[3];
+    int n = cfg.get_block(b).instructions[k].get_uses(u);
+    for (int j = 0; j < n; ++j) use(*u[j]);
+  }
+
+  // remove the rest
+  std::size_t count = 0;
+  for (auto b : rpo) {
+    std::vector<ssaForm::phi> &phis = ssa.get_phis(b);
+    std::vector<ssaForm::phi> kept;
+    for (auto &p : phis)
+      if (live.count(p.def)) kept.push_back(p);
+    phis.swap(kept);
+
+    instructionList &code = cfg.get_block(b).instructions;
+    std::size_t last = 0;
+    for (std::size_t k = 0; k < code.size(); ++k)
+      if (needed[b][k] or live.count(*code[k].get_def()))
+        code[last++] = code[k];
+    count += code.size() - last;
+    code.erase(code.begin() + last, code.end());
+  }
+  return count;
+}
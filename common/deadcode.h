@@ -0,0 +1,56 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    deadcode - Dead code elimination on SSA form
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+#include "ssa.h"
+
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class deadCodeElimination removes the instructions and phis whose
+/// SSA value is never used (directly, or by other useful values).
+/// Instructions with side effects (memory writes, calls, parameters,
+/// input/output, jumps) and the ones defining names that are not
+/// renamed are always kept; so are integer divisions that may divide
+/// by zero, which stop the program in tvm.
+
+class deadCodeElimination {
+public:
+  /// constructor
+  deadCodeElimination(ssaForm &ssa);
+
+  /// remove the dead code, and return the number of instructions removed
+  std::size_t run();
+
+private:
+  ssaForm &ssa;
+  controlFlowGraph &cfg;
+};
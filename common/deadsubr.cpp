@@ -0,0 +1,66 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    deadsubr - Removal of the subroutines that are never called
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+
+#include "deadsubr.h"
+
+#include <map>
+#include <set>
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'deadSubroutineElimination'
+
+deadSubroutineElimination::deadSubroutineElimination(code &program) : program(program) {}
+
+std::vector<std::string> deadSubroutineElimination::run() {
+  // call graph: the subroutines called by each one
+  std::map<std::string, std::set<std::string>> calls;
+  for (auto &subr : program.get_subroutines()) {
+    std::set<std::string> &callees = calls[subr.get_name()];
+    for (auto &i : subr.get_instructions())
+      if (i.oper == instruction::_CALL) callees.insert(i.arg1.get_name());
+  }
+  std::vector<std::string> removed;
+  if (calls.count("main") == 0) return removed;
+
+  std::set<std::string> used = {"main"};
+  std::vector<std::string> work = {"main"};
+  while (not work.empty()) {
+    std::string name = work.back();
+    work.pop_back();
+    for (auto &callee : calls[name])
+      if (used.insert(callee).second) work.push_back(callee);
+  }
+
+  for (auto &c : calls)
+    if (used.count(c.first) == 0) removed.push_back(c.first);
+  for (auto &name : removed)
+    program.remove_subroutine(name);
+  return removed;
+}
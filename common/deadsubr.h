@@ -0,0 +1,56 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    deadsubr - Removal of the subroutines that are never called
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include "code.h"
+
+#include <string>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class deadSubroutineElimination removes from the program the
+/// subroutines that can not be called: the ones that are not reached
+/// from "main" through the "call" instructions of the call graph.
+/// After inlining, these include the small subroutines whose calls
+/// have all been replaced by a copy of their body.
+/// Programs without a "main" are left as they are.
+
+class deadSubroutineElimination {
+public:
+  /// constructor
+  deadSubroutineElimination(code &program);
+
+  /// remove the unused subroutines, and return their names
+  std::vector<std::string> run();
+
+private:
+  code &program;
+};
@@ -0,0 +1,198 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    inliner - Inlining of small leaf subroutines
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "inliner.h"
+
+#include <algorithm>
+#include <string>
+
+
+// callees up to this number of instructions (labels apart) are inlined
+static const std::size_t MAX_INLINE_SIZE = 24;
+// no more calls are inlined in a subroutine that reaches this size
+static const std::size_t MAX_CALLER_SIZE = 2000;
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'inliner'
+
+inliner::inliner(code &program) : program(program), copies(0) {}
+
+/// a leaf subroutine, small enough
+bool inliner::inlinable(const subroutine &callee) const {
+  std::size_t size = 0;
+  for (auto &i : callee.get_instructions()) {
+    if (i.oper == instruction::_CALL) return false;
+    if (i.oper != instruction::_LABEL) ++size;
+  }
+  return size <= MAX_INLINE_SIZE;
+}
+
+/// inline the call at pc, if it has the shape generated by
+/// CodeGenVisitor::visitProcCall
+bool inliner::inline_call(subroutine &caller, instructionList &code, std::size_t pc,
+                          const subroutine &callee, int &lastTemp) {
+  std::size_t nParams = callee.params.size();
+  bool hasResult = nParams > 0 and callee.params.front().name == "_result";
+
+  std::vector<std::size_t> pushes;
+  if (not find_pushes(code, pc, callee, pushes)) return false;
+  std::size_t nPops = nParams;
+
+  // names of the copy: parameters and scalar locals become
+  // temporaries, local arrays new arrays of the caller
+  ++copies;
+  std::map<operand, operand> names;
+  std::vector<operand> paramTemps;
+  for (auto &p : callee.params) {
+    operand t = operand::TEMP(++lastTemp);
+    names[operand(p.name)] = t;
+    paramTemps.push_back(t);
+  }
+  std::vector<operand> arrays, scalars;
+  for (auto &i : callee.get_instructions())
+    if (i.oper == instruction::_ALOAD or i.oper == instruction::_LOADX) arrays.push_back(i.arg2);
+    else if (i.oper == instruction::_XLOAD) arrays.push_back(i.arg1);
+  for (auto &v : callee.vars) {
+    operand name(v.name);
+    if (v.size > 1 or std::find(arrays.begin(), arrays.end(), name) != arrays.end()) {
+      std::string copy = callee.get_name() + "_" + v.name + "_" + std::to_string(copies);
+      caller.add_var(copy, v.size);
+      names[name] = operand(copy);
+    }
+    else {
+      names[name] = operand::TEMP(++lastTemp);
+      scalars.push_back(names[name]);
+    }
+  }
+  operand labelEnd = operand::LABEL("endInline", copies);
+  auto rename = [&](const operand &o) -> operand {
+    if (o.is_temp() or o.is_label()) {
+      auto it = names.find(o);
+      if (it != names.end()) return it->second;
+      operand n = o.is_temp() ? operand::TEMP(++lastTemp)
+                              : operand::LABEL(o.dump() + "_inl", copies);
+      names[o] = n;
+      return n;
+    }
+    auto it = o.is_name() ? names.find(o) : names.end();
+    return it != names.end() ? it->second : o;
+  };
+
+  instructionList result;
+  std::size_t next = 0;
+  for (std::size_t k = 0; k < pushes.size(); ++k) {
+    result.insert(result.end(), code.begin() + next, code.begin() + pushes[k]);
+    if (not (hasResult and k == 0))
+      result.append(instruction::LOAD(paramTemps[k], code[pushes[k]].arg1));
+    next = pushes[k] + 1;
+  }
+  result.insert(result.end(), code.begin() + next, code.begin() + pc);
+  // locals start at 0 in each call, as tvm does
+  for (auto &t : scalars)
+    result.append(instruction::ILOAD(t, operand::ICONST(0)));
+  for (auto &i : callee.get_instructions()) {
+    if (i.oper == instruction::_RETURN)
+      result.append(instruction::UJUMP(labelEnd));
+    // an array parameter passed on: its temporary holds the address
+    else if (i.oper == instruction::_ALOAD and rename(i.arg2).is_temp())
+      result.append(instruction::LOAD(rename(i.arg1), rename(i.arg2)));
+    else
+      result.append(instruction(i.oper, rename(i.arg1), rename(i.arg2), rename(i.arg3)));
+  }
+  result.append(instruction::LABEL(labelEnd));
+  if (hasResult)
+    result.append(instruction::LOAD(code[pc+nPops].arg1, paramTemps[0]));
+  result.insert(result.end(), code.begin() + pc + nPops + 1, code.end());
+  code = std::move(result);
+  return true;
+}
+
+/// pushes of a call, and check its pops
+bool inliner::find_pushes(const instructionList &code, std::size_t pc,
+                          const subroutine &callee, std::vector<std::size_t> &pushes) {
+  std::size_t nParams = callee.params.size();
+  bool hasResult = nParams > 0 and callee.params.front().name == "_result";
+  std::size_t nArgs = nParams - (hasResult ? 1 : 0);
+
+  // the pushes of this call (those of nested calls are matched by
+  // their pops), in straight-line code
+  pushes.clear();
+  int depth = 0;
+  for (std::size_t k = pc; k-- > 0 and pushes.size() < nParams; ) {
+    const instruction &i = code[k];
+    if (i.oper == instruction::_POP) ++depth;
+    else if (i.oper == instruction::_PUSH) {
+      if (depth > 0) --depth;
+      else pushes.push_back(k);
+    }
+    else if (i.oper == instruction::_LABEL or i.ends_block() or
+             (i.oper == instruction::_CALL and depth == 0))
+      return false;
+  }
+  if (pushes.size() != nParams) return false;
+  std::reverse(pushes.begin(), pushes.end());
+  if (hasResult and not code[pushes[0]].arg1.empty()) return false;
+
+  // and its pops
+  if (pc + nParams >= code.size()) return false;
+  for (std::size_t k = 1; k <= nArgs; ++k)
+    if (code[pc+k].oper != instruction::_POP or not code[pc+k].arg1.empty()) return false;
+  return not hasResult or
+         (code[pc+nParams].oper == instruction::_POP and not code[pc+nParams].arg1.empty());
+}
+
+std::size_t inliner::inline_calls(subroutine &caller) {
+  instructionList code = caller.get_instructions();
+  int lastTemp = 0;
+  for (auto &i : code)
+    for (const operand *o : {&i.arg1, &i.arg2, &i.arg3})
+      if (o->is_temp()) lastTemp = std::max(lastTemp, o->get_value());
+
+  std::size_t count = 0;
+  for (std::size_t pc = 0; pc < code.size() and code.size() < MAX_CALLER_SIZE; ++pc) {
+    if (code[pc].oper != instruction::_CALL) continue;
+    const subroutine *callee = nullptr;
+    for (auto &s : program.get_subroutines())
+      if (s.get_name() == code[pc].arg1.get_name()) callee = &s;
+    if (callee == nullptr or callee == &caller or not inlinable(*callee)) continue;
+    if (inline_call(caller, code, pc, *callee, lastTemp)) ++count;
+  }
+  if (count > 0) {
+    caller.set_instructions(std::move(code));
+    caller.finalize();
+  }
+  return count;
+}
+
+std::vector<std::size_t> inliner::run() {
+  std::vector<std::size_t> counts;
+  for (auto &s : program.get_subroutines())
+    counts.push_back(inline_calls(s));
+  return counts;
+}
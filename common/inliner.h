@@ -0,0 +1,80 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    inliner - Inlining of small leaf subroutines
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include "code.h"
+
+#include <map>
+#include <vector>
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class inliner replaces the calls to small leaf subroutines (no
+/// calls of their own) by a copy of their body. The call sequence
+///     pushparam            (result slot)
+///     pushparam a_i        (one per parameter)
+///     call f
+///     popparam             (one per parameter)
+///     popparam r           (result)
+/// becomes "p_i = a_i" for each parameter, the body of f with its
+/// temporaries, parameters, local variables and labels renamed, and
+/// "r = _result". Parameters become temporaries of the caller: arrays
+/// are passed by address, so the temporary holds the same address
+/// the callee would have received. Scalar locals become temporaries
+/// too (set to 0 at the start of the copy, as tvm does on each call),
+/// local arrays new local arrays of the caller. Each "return" jumps to
+/// the end of the copy.
+
+class inliner {
+public:
+  /// constructor
+  inliner(code &program);
+
+  /// inline the calls of all the subroutines, and return the number
+  /// of calls inlined in each one (in the order of get_subroutines)
+  std::vector<std::size_t> run();
+
+  /// positions of the pushes of the parameters of the call at pc, in
+  /// order (the result slot first); false if the call does not have
+  /// the shape above, in straight-line code
+  static bool find_pushes(const instructionList &code, std::size_t pc,
+                          const subroutine &callee, std::vector<std::size_t> &pushes);
+
+private:
+  code &program;
+  /// copies made so far (to make names and labels unique)
+  int copies;
+
+  bool inlinable(const subroutine &callee) const;
+  std::size_t inline_calls(subroutine &caller);
+  bool inline_call(subroutine &caller, instructionList &code, std::size_t pc,
+                   const subroutine &callee, int &lastTemp);
+};
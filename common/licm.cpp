@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    licm - Loop-invariant code motion on SSA form
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "licm.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'loopInvariantMotion'
+
+loopInvariantMotion::loopInvariantMotion(ssaForm &ssa) : ssa(ssa), cfg(ssa.get_cfg()) {}
+
+/// move the invariant instructions of the loop with the given header
+std::size_t loopInvariantMotion::hoist(std::size_t header) {
+  const std::vector<controlFlowGraph::loop> &loops = cfg.get_loops();
+  int l = cfg.get_loop_of(header);
+  if (l < 0 or loops[l].header != header) return 0;
+  std::vector<std::size_t> blocks = loops[l].blocks;
+  auto in_loop = [&](std::size_t b) {
+    return std::binary_search(blocks.begin(), blocks.end(), b);
+  };
+
+  bool entered = false;
+  for (auto p : cfg.get_block(header).preds)
+    entered = entered or (not in_loop(p) and cfg.is_reachable(p));
+  if (not entered) return 0;
+
+  // values defined in the loop, memory written in it, and exits
+  std::set<operand> variant;
+  bool writes = false;
+  std::vector<std::size_t> exits;
+  for (auto b : blocks) {
+    for (auto &p : ssa.get_phis(b))
+      variant.insert(p.def);
+    for (auto &i : cfg.get_block(b).instructions) {
+      const operand *d = i.get_def();
+      if (d != nullptr and ssa.is_value(*d)) variant.insert(*d);
+      if (i.writes_memory() or (d != nullptr and not ssa.is_value(*d))) writes = true;
+    }
+    for (auto s : cfg.get_block(b).succs)
+      if (not in_loop(s)) {
+        exits.push_back(b);
+        break;
+      }
+  }
+
+  // invariant instructions, in dominance order
+  instructionList moved;
+  for (auto b : cfg.get_reverse_postorder()) {
+    if (not in_loop(b)) continue;
+    bool always = true;
+    for (auto e : exits)
+      always = always and cfg.dominates(b, e);
+    instructionList &code = cfg.get_block(b).instructions;
+    std::size_t last = 0;
+    for (std::size_t k = 0; k < code.size(); ++k) {
+      const instruction &i = code[k];
+      const operand *d = i.get_def();
+      bool invariant = d != nullptr and ssa.is_value(*d) and not i.has_side_effects();
+      bool reads = i.reads_memory();
+      if (i.oper != instruction::_ALOAD)
+        for (const operand *a : {&i.arg2, &i.arg3})
+          reads = reads or (a->is_name() and not ssa.is_value(*a));
+      bool traps = i.oper == instruction::_DIV or i.oper == instruction::_LOADX or
+                   i.oper == instruction::_LOADC;
+      invariant = invariant and not (reads and writes) and not (traps and not always);
+      const operand *u[3];
+      int n = i.get_uses(u);
+      for (int j = 0; j < n and invariant; ++j)
+        invariant = variant.find(*u[j]) == variant.end();
+      if (invariant) {
+        variant.erase(*d);
+        moved.append(i);
+      }
+      else code[last++] = code[k];
+    }
+    code.erase(code.begin() + last, code.end());
+  }
+  if (moved.empty()) return 0;
+
+  // the preheader (the loop is copied, since a new block changes the loops)
+  controlFlowGraph::loop lp = loops[l];
+  std::size_t pre = ssa.get_preheader(lp);
+  instructionList &code = cfg.get_block(pre).instructions;
+  bool jump = not code.empty() and code.back().ends_block();
+  code.insert(code.end() - (jump ? 1 : 0), moved.begin(), moved.end());
+  return moved.size();
+}
+
+std::size_t loopInvariantMotion::run() {
+  // headers of the loops, inner loops first
+  std::vector<std::size_t> headers;
+  for (auto &l : cfg.get_loops())
+    headers.push_back(l.header);
+  std::size_t count = 0;
+  for (std::size_t k = headers.size(); k-- > 0; )
+    count += hoist(headers[k]);
+  return count;
+}
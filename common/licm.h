@@ -0,0 +1,65 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    licm - Loop-invariant code motion on SSA form
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+#include "ssa.h"
+
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class loopInvariantMotion moves out of each loop (inner loops
+/// first) the instructions whose operands do not change in the loop,
+/// to a preheader: the block before the header, or a new block when
+/// the header is entered from several places or from a conditional
+/// jump.
+///
+/// Only instructions without side effects are moved (never READ*,
+/// WRITE*, calls, parameters or stores). Reads of memory (LOADX,
+/// LOADC, names that are not renamed) are moved only out of loops
+/// that do not write memory (XLOAD, CLOAD, calls) or those names.
+/// Instructions that may stop the program (integer division, array
+/// and address reads) are moved only when they run in every iteration
+/// that exits the loop, since the loop may run zero times.
+
+class loopInvariantMotion {
+public:
+  /// constructor
+  loopInvariantMotion(ssaForm &ssa);
+
+  /// move the invariant instructions, and return how many were moved
+  std::size_t run();
+
+private:
+  ssaForm &ssa;
+  controlFlowGraph &cfg;
+
+  std::size_t hoist(std::size_t header);
+};
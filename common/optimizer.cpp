@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    optimizer - Optimization passes on the generated t-code
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "optimizer.h"
+#include "inliner.h"
+#include "tailcall.h"
+#include "unroll.h"
+#include "deadsubr.h"
+#include "ssa.h"
+#include "constprop.h"
+#include "unreachable.h"
+#include "valuenum.h"
+#include "licm.h"
+#include "strength.h"
+#include "copyprop.h"
+#include "deadcode.h"
+#include "branches.h"
+#include "peephole.h"
+#include "tempalloc.h"
+
+#include <utility>
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'optimizer'
+
+optimizer::optimizer(std::size_t unrollFactor) : unrollFactor(unrollFactor) {}
+
+void optimizer::optimize(code &c) {
+  // small leaf subroutines are inlined first, so that their code is
+  // optimized in the context of each call
+  std::vector<std::size_t> sizes;
+  for (auto &subr : c.get_subroutines())
+    sizes.push_back(subr.get_instructions().size());
+  std::vector<std::size_t> inlined = inliner(c).run();
+
+  for (std::size_t k = 0; k < c.get_subroutines().size(); ++k) {
+    optimize(c.get_subroutines()[k]);
+    report &r = reports.back();
+    r.before = sizes[k];
+    r.passes.insert(r.passes.begin(), std::make_pair("calls inlined", inlined[k]));
+  }
+
+  // the subroutines no longer called (inlined everywhere, or called
+  // only from code that was removed) are dropped from the program
+  std::size_t first = reports.size() - inlined.size();
+  for (auto &name : deadSubroutineElimination(c).run())
+    for (std::size_t k = first; k < reports.size(); ++k)
+      if (reports[k].name == name) {
+        reports[k].after = 0;
+        reports[k].passes.push_back(std::make_pair("subroutine removed", 1));
+      }
+}
+
+void optimizer::optimize(subroutine &subr) {
+  report r;
+  r.name = subr.get_name();
+  r.before = subr.get_instructions().size();
+
+  // self tail calls become jumps before building the SSA form (the loop
+  // they make is then optimized like any other)
+  r.passes.push_back(std::make_pair("tail calls removed", tailCallElimination().run(subr)));
+  // unrolled before the SSA form too, so that the copies are folded
+  r.passes.push_back(std::make_pair("loops unrolled", loopUnrolling(unrollFactor).run(subr)));
+  ssaForm ssa(subr);
+  r.passes.push_back(std::make_pair("constants folded", constantFolding(ssa).run()));
+  // after folding, so that the branches it removes are taken too
+  r.passes.push_back(std::make_pair("unreachable instructions", unreachableCode(ssa).run()));
+  // induction variables are only seen through the copies of the loop counters
+  std::size_t copies = copyPropagation(ssa).run();
+  r.passes.push_back(std::make_pair("invariants moved", loopInvariantMotion(ssa).run()));
+  r.passes.push_back(std::make_pair("induction variables reduced", strengthReduction(ssa).run()));
+  r.passes.push_back(std::make_pair("redundant expressions", valueNumbering(ssa).run()));
+  copies += copyPropagation(ssa).run();
+  r.passes.push_back(std::make_pair("copies propagated", copies));
+  r.passes.push_back(std::make_pair("dead instructions", deadCodeElimination(ssa).run()));
+  subr.set_instructions(ssa.destruct());
+  subr.finalize();
+  r.passes.push_back(std::make_pair("branches simplified", branchSimplification().run(subr)));
+  r.passes.push_back(std::make_pair("peephole rewrites", peephole().run(subr)));
+  r.passes.push_back(std::make_pair("temporaries saved", temporaryAllocation().run(subr)));
+
+  r.after = subr.get_instructions().size();
+  reports.push_back(r);
+}
+
+std::string optimizer::dump_report() const {
+  std::string s;
+  for (auto &r : reports) {
+    long removed = long(r.before) - long(r.after);
+    s += r.name + ": " + std::to_string(r.before) + " -> " + std::to_string(r.after) +
+         " instructions (" + std::to_string(removed) + " removed)";
+    for (std::size_t k = 0; k < r.passes.size(); ++k)
+      s += (k == 0 ? "; " : ", ") + r.passes[k].first + " " + std::to_string(r.passes[k].second);
+    s += "\n";
+  }
+  return s;
+}
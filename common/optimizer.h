@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    optimizer - Optimization passes on the generated t-code
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class optimizer runs the optimization passes on each subroutine
+/// of the generated code (after inlining the calls to small leaf
+/// subroutines, see inliner). The passes that need it work on the SSA
+/// form of the subroutine, which is translated back to t-code at the
+/// end. The subroutines that are not called any more are then removed
+/// from the program. It keeps a report of what each pass did to each
+/// subroutine.
+
+class optimizer {
+public:
+  /// constructor (loops with a known number of iterations are
+  /// unrolled up to the given factor, see loopUnrolling)
+  optimizer(std::size_t unrollFactor = 4);
+
+  /// optimize all the subroutines
+  void optimize(code &c);
+  /// optimize one subroutine
+  void optimize(subroutine &subr);
+
+  /// instructions removed from each subroutine, and the work of each pass
+  std::string dump_report() const;
+
+private:
+  /// Class report stores the sizes of a subroutine before and after
+  /// the optimization, and the count returned by each pass
+  class report {
+  public:
+    std::string name;
+    std::size_t before, after;
+    std::vector<std::pair<std::string, std::size_t>> passes;
+  };
+
+  std::size_t unrollFactor;
+  std::vector<report> reports;
+};
@@ -0,0 +1,234 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    peephole - Table-driven peephole optimizer for t-code
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "peephole.h"
+
+#include <utility>
+
+
+////////////////////////////////////////////////////////////////////
+/// Rules
+
+namespace {
+
+  typedef std::map<operand, int> useCounts;
+
+  bool single_use(const useCounts &uses, const operand &t) {
+    auto it = uses.find(t);
+    return t.is_temp() and it != uses.end() and it->second == 1;
+  }
+
+  // the value of a temporary set by w[0] is only used by w[1], to
+  // compute the same temporary or as its single use
+  bool used_once(const useCounts &uses, const instruction *w) {
+    return w[1].arg2 == w[0].arg1 and (w[1].arg1 == w[0].arg1 or single_use(uses, w[0].arg1));
+  }
+
+  // "t = a <= b; u = not t" => "u = b < a" (and the same with <);
+  // so "LE; NOT; FJUMP" becomes a jump on the inverted comparison
+  bool invert_less_equal(const instruction *w, const useCounts &uses, instructionList &r) {
+    if (not used_once(uses, w)) return false;
+    r.append(instruction::LT(w[1].arg1, w[0].arg3, w[0].arg2));
+    return true;
+  }
+  bool invert_less(const instruction *w, const useCounts &uses, instructionList &r) {
+    if (not used_once(uses, w)) return false;
+    r.append(instruction::LE(w[1].arg1, w[0].arg3, w[0].arg2));
+    return true;
+  }
+
+  // "t = not a; u = not t" => "u = a"
+  bool double_not(const instruction *w, const useCounts &uses, instructionList &r) {
+    if (not used_once(uses, w)) return false;
+    r.append(instruction::LOAD(w[1].arg1, w[0].arg2));
+    return true;
+  }
+
+  // "t = k; u = float t" => "u = k.0"
+  bool float_of_constant(const instruction *w, const useCounts &uses, instructionList &r) {
+    if (not used_once(uses, w)) return false;
+    r.append(instruction::FLOAD(w[1].arg1, operand::FCONST(w[0].arg2.dump() + ".0")));
+    return true;
+  }
+
+  // "goto L; label L" and "ifFalse c goto L; label L" => "label L"
+  bool jump_to_next(const instruction *w, const useCounts &, instructionList &r) {
+    const operand &target = w[0].oper == instruction::_UJUMP ? w[0].arg1 : w[0].arg2;
+    if (target != w[1].arg1) return false;
+    r.append(w[1]);
+    return true;
+  }
+
+  // "t = ...; x = t" => "x = ..."
+  bool store_result(const instruction *w, const useCounts &uses, instructionList &r) {
+    const operand *d = w[0].get_def();
+    if (d != &w[0].arg1 or w[1].arg2 != *d or w[1].arg1 == *d or not single_use(uses, *d))
+      return false;
+    instruction i = w[0];
+    i.arg1 = w[1].arg1;
+    r.append(i);
+    return true;
+  }
+
+  // "x = x" => nothing
+  bool self_copy(const instruction *w, const useCounts &, instructionList &) {
+    return w[0].arg1 == w[0].arg2;
+  }
+
+  typedef bool (*rewriteFunction)(const instruction *window, const useCounts &uses,
+                                  instructionList &replacement);
+
+  const int maxLength = 2;
+  struct rule {
+    int length;
+    instruction::Operation pattern[maxLength];
+    rewriteFunction rewrite;
+  };
+
+  // the rules: instruction codes of the pattern, and the function that
+  // checks the operands and builds the replacement
+  constexpr rule rules[] = {
+    { 2, { instruction::_LE,     instruction::_NOT   }, invert_less_equal },
+    { 2, { instruction::_LT,     instruction::_NOT   }, invert_less },
+    { 2, { instruction::_NOT,    instruction::_NOT   }, double_not },
+    { 2, { instruction::_ILOAD,  instruction::_FLOAT }, float_of_constant },
+    { 2, { instruction::_UJUMP,  instruction::_LABEL }, jump_to_next },
+    { 2, { instruction::_FJUMP,  instruction::_LABEL }, jump_to_next },
+    { 1, { instruction::_LOAD                        }, self_copy },
+    { 2, { instruction::_ADD,    instruction::_LOAD  }, store_result },
+    { 2, { instruction::_SUB,    instruction::_LOAD  }, store_result },
+    { 2, { instruction::_MUL,    instruction::_LOAD  }, store_result },
+    { 2, { instruction::_DIV,    instruction::_LOAD  }, store_result },
+    { 2, { instruction::_EQ,     instruction::_LOAD  }, store_result },
+    { 2, { instruction::_LT,     instruction::_LOAD  }, store_result },
+    { 2, { instruction::_LE,     instruction::_LOAD  }, store_result },
+    { 2, { instruction::_NEG,    instruction::_LOAD  }, store_result },
+    { 2, { instruction::_NOT,    instruction::_LOAD  }, store_result },
+    { 2, { instruction::_AND,    instruction::_LOAD  }, store_result },
+    { 2, { instruction::_OR,     instruction::_LOAD  }, store_result },
+    { 2, { instruction::_FLOAT,  instruction::_LOAD  }, store_result },
+    { 2, { instruction::_FADD,   instruction::_LOAD  }, store_result },
+    { 2, { instruction::_FSUB,   instruction::_LOAD  }, store_result },
+    { 2, { instruction::_FMUL,   instruction::_LOAD  }, store_result },
+    { 2, { instruction::_FDIV,   instruction::_LOAD  }, store_result },
+    { 2, { instruction::_FEQ,    instruction::_LOAD  }, store_result },
+    { 2, { instruction::_FLT,    instruction::_LOAD  }, store_result },
+    { 2, { instruction::_FLE,    instruction::_LOAD  }, store_result },
+    { 2, { instruction::_FNEG,   instruction::_LOAD  }, store_result },
+    { 2, { instruction::_LOAD,   instruction::_LOAD  }, store_result },
+    { 2, { instruction::_ILOAD,  instruction::_LOAD  }, store_result },
+    { 2, { instruction::_CHLOAD, instruction::_LOAD  }, store_result },
+    { 2, { instruction::_FLOAD,  instruction::_LOAD  }, store_result },
+    { 2, { instruction::_LOADX,  instruction::_LOAD  }, store_result },
+    { 2, { instruction::_ALOAD,  instruction::_LOAD  }, store_result },
+    { 2, { instruction::_LOADC,  instruction::_LOAD  }, store_result },
+    { 2, { instruction::_POP,    instruction::_LOAD  }, store_result },
+    { 2, { instruction::_READI,  instruction::_LOAD  }, store_result },
+    { 2, { instruction::_READF,  instruction::_LOAD  }, store_result },
+    { 2, { instruction::_READC,  instruction::_LOAD  }, store_result },
+  };
+  const int numRules = sizeof(rules) / sizeof(rules[0]);
+  const int numOperations = instruction::_INVALID + 1;
+
+  // index of the rules by their last instruction code, built at
+  // compile time: first rule for each code, and next rule with the
+  // same last code as each rule (-1 at the end of the chain)
+  constexpr int last_code(int k) {
+    return rules[k].pattern[rules[k].length - 1];
+  }
+  constexpr int find_rule(int code, int k) {
+    return k == numRules ? -1 : last_code(k) == code ? k : find_rule(code, k + 1);
+  }
+
+  template <int... I> struct indices {};
+  template <int N, int... I> struct make_indices : make_indices<N - 1, N - 1, I...> {};
+  template <int... I> struct make_indices<0, I...> { typedef indices<I...> type; };
+
+  template <int N> struct ruleIndex { int entry[N]; };
+
+  template <int... Code>
+  constexpr ruleIndex<sizeof...(Code)> first_rules(indices<Code...>) {
+    return ruleIndex<sizeof...(Code)>{{ find_rule(Code, 0)... }};
+  }
+  template <int... K>
+  constexpr ruleIndex<sizeof...(K)> next_rules(indices<K...>) {
+    return ruleIndex<sizeof...(K)>{{ find_rule(last_code(K), K + 1)... }};
+  }
+
+  constexpr ruleIndex<numOperations> firstRule = first_rules(make_indices<numOperations>::type());
+  constexpr ruleIndex<numRules> nextRule = next_rules(make_indices<numRules>::type());
+
+  static_assert(firstRule.entry[instruction::_LOAD] >= 0, "rules are indexed by their last code");
+
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'peephole'
+
+peephole::peephole() : count(0) {}
+
+/// copy an instruction to the output, and apply the rules that match
+/// the instructions ending with it
+void peephole::emit(const instruction &i) {
+  out.append(i);
+  for (int k = firstRule.entry[i.oper]; k >= 0; k = nextRule.entry[k]) {
+    const rule &r = rules[k];
+    if (out.size() < std::size_t(r.length)) continue;
+    const instruction *w = &out[out.size() - r.length];
+    bool match = true;
+    for (int j = 0; j < r.length - 1 and match; ++j)
+      match = w[j].oper == r.pattern[j];
+    instructionList replacement;
+    if (not match or not r.rewrite(w, uses, replacement)) continue;
+    out.erase(out.end() - r.length, out.end());
+    ++count;
+    for (auto &ri : replacement)
+      emit(ri);
+    return;
+  }
+}
+
+std::size_t peephole::run(subroutine &subr) {
+  const instructionList &code = subr.get_instructions();
+  uses.clear();
+  for (auto &i : code) {
+    const operand *u[3];
+    int n = i.get_uses(u);
+    for (int k = 0; k < n; ++k)
+      if (u[k]->is_temp()) ++uses[*u[k]];
+  }
+  count = 0;
+  out = instructionList();
+  out.reserve(code.size());
+  for (auto &i : code)
+    emit(i);
+  subr.set_instructions(std::move(out));
+  subr.finalize();
+  return count;
+}
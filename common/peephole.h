@@ -0,0 +1,66 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    peephole - Table-driven peephole optimizer for t-code
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <map>
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class peephole rewrites short sequences of instructions of a
+/// subroutine, following the rules of a table (in peephole.cpp).
+///
+/// Instructions are copied one by one to the output, and the rules
+/// are tried on the sequence ending at the last one copied. Rules are
+/// indexed by their last instruction code in tables built at compile
+/// time, so only the rules that may match are tried. A replacement
+/// is copied again in the same way, so rules apply on the results of
+/// other rules. Every replacement is shorter than its pattern.
+
+class peephole {
+public:
+  /// constructor
+  peephole();
+
+  /// rewrite the instructions of a subroutine, and return the number
+  /// of rules applied
+  std::size_t run(subroutine &subr);
+
+private:
+  /// uses of each temporary in the subroutine (before the rewriting;
+  /// rules only remove uses, so a temporary that appears used once
+  /// inside a pattern is used only there)
+  std::map<operand, int> uses;
+  instructionList out;
+  std::size_t count;
+
+  void emit(const instruction &i);
+};
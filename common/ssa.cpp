@@ -0,0 +1,626 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    ssa - Static single assignment form of a t-code subroutine
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "ssa.h"
+
+#include <algorithm>
+#include <iterator>
+
+
+////////////////////////////////////////////////////////////////////
+/// Construction
+
+ssaForm::ssaForm(const subroutine &subr) : cfg(subr), lastTemp(0) {
+  phis.resize(cfg.get_num_blocks());
+
+  // names used as arrays, and all the temporaries
+  std::set<operand> arrays;
+  for (std::size_t b = 0; b < cfg.get_num_blocks(); ++b)
+    for (auto &i : cfg.get_block(b).instructions) {
+      if (i.oper == instruction::_XLOAD and i.arg1.is_name()) arrays.insert(i.arg1);
+      if (i.oper == instruction::_LOADX and i.arg2.is_name()) arrays.insert(i.arg2);
+      if (i.oper == instruction::_ALOAD and i.arg2.is_name()) arrays.insert(i.arg2);
+      for (const operand *a : {&i.arg1, &i.arg2, &i.arg3})
+        if (a->is_temp()) {
+          renamed.insert(*a);
+          lastTemp = std::max(lastTemp, a->get_value());
+        }
+    }
+
+  // scalar locals, and parameters (those passed by address are only
+  // read, to get the address, so renaming them changes nothing)
+  for (auto &v : subr.vars) {
+    operand name = operand::NAME(v.name);
+    if (v.size == 1 and arrays.find(name) == arrays.end())
+      renamed.insert(name);
+  }
+  for (auto &p : subr.params) {
+    operand name = operand::NAME(p.name);
+    if (p.name != "_result" and arrays.find(name) == arrays.end())
+      renamed.insert(name);
+  }
+
+  place_phis();
+  rename();
+}
+
+/// insert phis at the dominance frontiers of the definitions of each
+/// variable that is live across blocks (semi-pruned SSA)
+void ssaForm::place_phis() {
+  std::size_t nb = cfg.get_num_blocks();
+  std::set<operand> globals;
+  std::map<operand, std::vector<std::size_t>> defBlocks;
+  for (auto b : cfg.get_reverse_postorder()) {
+    std::set<operand> defined;
+    for (auto &i : cfg.get_block(b).instructions) {
+      const operand *u[3];
+      int n = i.get_uses(u);
+      for (int k = 0; k < n; ++k)
+        if (is_renamed(*u[k]) and defined.find(*u[k]) == defined.end())
+          globals.insert(*u[k]);
+      const operand *d = i.get_def();
+      if (d != nullptr and is_renamed(*d) and defined.insert(*d).second)
+        defBlocks[*d].push_back(b);
+    }
+  }
+
+  std::vector<int> hasPhi(nb, -1), inWork(nb, -1);
+  int stamp = 0;
+  for (auto &var : globals) {
+    std::vector<std::size_t> work = defBlocks[var];
+    for (auto b : work) inWork[b] = stamp;
+    while (not work.empty()) {
+      std::size_t b = work.back();
+      work.pop_back();
+      for (auto d : cfg.get_dom_frontier(b)) {
+        if (hasPhi[d] == stamp) continue;
+        hasPhi[d] = stamp;
+        phi p;
+        p.def = var;
+        p.args.assign(cfg.get_block(d).preds.size(), var);
+        phis[d].push_back(p);
+        if (inWork[d] != stamp) {
+          inWork[d] = stamp;
+          work.push_back(d);
+        }
+      }
+    }
+    ++stamp;
+  }
+}
+
+/// give a new name to each definition, walking the dominator tree
+void ssaForm::rename() {
+  std::map<operand, std::vector<operand>> stacks;
+  auto current = [&](const operand &var) -> operand {
+    auto it = stacks.find(var);
+    return (it == stacks.end() or it->second.empty()) ? var : it->second.back();
+  };
+  auto fresh = [&](const operand &var) -> operand {
+    operand n = new_temp();
+    variable[n] = var;
+    stacks[var].push_back(n);
+    return n;
+  };
+
+  // explicit stack of (block, pushed variables), so deep trees do not overflow
+  struct frame { std::size_t block; std::size_t child; std::vector<operand> pushed; };
+  std::vector<frame> walk;
+  walk.push_back(frame{0, 0, std::vector<operand>()});
+  bool entering = true;
+  while (not walk.empty()) {
+    frame &f = walk.back();
+    if (entering) {
+      basicBlock &blk = cfg.get_block(f.block);
+      for (auto &p : phis[f.block]) {
+        operand var = p.def;
+        p.def = fresh(var);
+        f.pushed.push_back(var);
+      }
+      for (auto &i : blk.instructions) {
+        operand *u[3];
+        int n = i.get_uses(u);
+        for (int k = 0; k < n; ++k)
+          if (is_renamed(*u[k])) *u[k] = current(*u[k]);
+        operand *d = i.get_def();
+        if (d != nullptr and is_renamed(*d)) {
+          operand var = *d;
+          *d = fresh(var);
+          f.pushed.push_back(var);
+        }
+      }
+      for (auto s : blk.succs) {
+        const std::vector<std::size_t> &preds = cfg.get_block(s).preds;
+        std::size_t j = std::find(preds.begin(), preds.end(), f.block) - preds.begin();
+        for (auto &p : phis[s])
+          p.args[j] = current(get_variable(p.def));
+      }
+    }
+    const std::vector<std::size_t> &children = cfg.get_dom_children(f.block);
+    if (f.child < children.size()) {
+      std::size_t c = children[f.child++];
+      walk.push_back(frame{c, 0, std::vector<operand>()});
+      entering = true;
+    }
+    else {
+      for (auto &var : f.pushed)
+        stacks[var].pop_back();
+      walk.pop_back();
+      entering = false;
+    }
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Accessors
+
+controlFlowGraph & ssaForm::get_cfg() { return cfg; }
+std::vector<ssaForm::phi> & ssaForm::get_phis(std::size_t b) { return phis[b]; }
+
+bool ssaForm::is_renamed(const operand &var) const {
+  return renamed.find(var) != renamed.end();
+}
+operand ssaForm::get_variable(const operand &name) const {
+  auto it = variable.find(name);
+  return it == variable.end() ? name : it->second;
+}
+
+bool ssaForm::is_value(const operand &o) const {
+  return o.is_temp() or is_renamed(o);
+}
+
+operand ssaForm::new_temp() {
+  // its own variable: only the values on entry have none
+  operand t = operand::TEMP(++lastTemp);
+  variable[t] = t;
+  return t;
+}
+
+void ssaForm::remove_edge(std::size_t from, std::size_t to) {
+  const std::vector<std::size_t> &preds = cfg.get_block(to).preds;
+  std::size_t j = std::find(preds.begin(), preds.end(), from) - preds.begin();
+  for (auto &p : phis[to])
+    p.args.erase(p.args.begin() + j);
+  cfg.remove_edge(from, to);
+}
+
+std::size_t ssaForm::insert_block(std::size_t b, const std::vector<std::size_t> &from) {
+  std::vector<std::size_t> oldPreds = cfg.get_block(b).preds;
+  std::size_t n = cfg.insert_block(b, from);
+  phis.resize(cfg.get_num_blocks());
+  for (auto &p : phis[b]) {
+    std::map<std::size_t, operand> argOf;
+    for (std::size_t j = 0; j < oldPreds.size(); ++j)
+      argOf[oldPreds[j]] = p.args[j];
+    operand merged = argOf[from[0]];
+    for (auto f : from)
+      if (argOf[f] != merged) {
+        phi q;
+        q.def = new_temp();
+        variable[q.def] = get_variable(p.def);
+        for (auto pred : cfg.get_block(n).preds)
+          q.args.push_back(argOf[pred]);
+        phis[n].push_back(q);
+        merged = q.def;
+        break;
+      }
+    argOf[n] = merged;
+    p.args.clear();
+    for (auto pred : cfg.get_block(b).preds)
+      p.args.push_back(argOf[pred]);
+  }
+  return n;
+}
+
+int ssaForm::get_preheader(const controlFlowGraph::loop &l) {
+  std::size_t header = l.header;
+  std::vector<std::size_t> outside;
+  for (auto p : cfg.get_block(header).preds)
+    if (not l.contains(p) and cfg.is_reachable(p)) outside.push_back(p);
+  if (outside.empty()) return -1;
+  const basicBlock &pred = cfg.get_block(outside[0]);
+  const instruction *t = pred.get_terminator();
+  if (outside.size() == 1 and pred.succs.size() == 1 and
+      (t == nullptr or t->oper == instruction::_UJUMP))
+    return outside[0];
+  std::size_t n = insert_block(header, outside);
+  cfg.update();
+  return n;
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// Destruction
+
+namespace {
+
+  // position of a definition or a use: block and index of the
+  // instruction (-1 for phis, -2 for the values on entry)
+  struct site { std::size_t block; int index; };
+
+  // sorted vectors used as sets of values
+  typedef std::vector<int> valueSet;
+
+  void add_to(valueSet &s, int v) {
+    auto it = std::lower_bound(s.begin(), s.end(), v);
+    if (it == s.end() or *it != v) s.insert(it, v);
+  }
+  bool contains(const valueSet &s, int v) {
+    return std::binary_search(s.begin(), s.end(), v);
+  }
+
+  // disjoint sets of values (the names coalesced together)
+  int find_root(std::vector<int> &parent, int x) {
+    while (parent[x] != x) x = parent[x] = parent[parent[x]];
+    return x;
+  }
+
+  // copy of a value or a constant into dest
+  instruction copy_of(const operand &dest, const operand &src) {
+    switch (src.get_kind()) {
+    case operand::_ICONST:  return instruction::ILOAD(dest, src);
+    case operand::_FCONST:  return instruction::FLOAD(dest, src);
+    case operand::_CHCONST: return instruction::CHLOAD(dest, src);
+    default:                return instruction::LOAD(dest, src);
+    }
+  }
+
+}
+
+instructionList ssaForm::destruct() {
+  std::size_t nb = cfg.get_num_blocks();
+  const std::vector<std::size_t> &rpo = cfg.get_reverse_postorder();
+
+  // number the SSA values, and find their definitions and uses
+  std::map<operand, int> id;
+  std::vector<operand> value;
+  std::vector<site> defSite;
+  std::vector<std::vector<site>> useSites;
+  auto value_id = [&](const operand &o) -> int {
+    if (not is_value(o)) return -1;
+    auto it = id.find(o);
+    if (it != id.end()) return it->second;
+    int k = value.size();
+    id[o] = k;
+    value.push_back(o);
+    defSite.push_back(site{0, -2});
+    useSites.push_back(std::vector<site>());
+    return k;
+  };
+
+  std::vector<valueSet> gen(nb), kill(nb), liveOut(nb), liveIn(nb);
+  for (auto b : rpo) {
+    for (auto &p : phis[b]) {
+      int d = value_id(p.def);
+      defSite[d] = site{b, -1};
+      add_to(kill[b], d);
+    }
+    const instructionList &code = cfg.get_block(b).instructions;
+    for (std::size_t k = 0; k < code.size(); ++k) {
+      const operand *u[3];
+      int n = code[k].get_uses(u);
+      for (int j = 0; j < n; ++j) {
+        int v = value_id(*u[j]);
+        if (v < 0) continue;
+        useSites[v].push_back(site{b, int(k)});
+        if (not contains(kill[b], v)) add_to(gen[b], v);
+      }
+      const operand *d = code[k].get_def();
+      int v = d ? value_id(*d) : -1;
+      if (v >= 0) {
+        defSite[v] = site{b, int(k)};
+        add_to(kill[b], v);
+      }
+    }
+  }
+  // phi arguments are live at the end of their predecessor
+  std::vector<valueSet> phiUses(nb);
+  for (auto b : rpo)
+    for (auto &p : phis[b])
+      for (std::size_t j = 0; j < p.args.size(); ++j) {
+        std::size_t pred = cfg.get_block(b).preds[j];
+        int v = value_id(p.args[j]);
+        if (v >= 0 and cfg.is_reachable(pred)) add_to(phiUses[pred], v);
+      }
+
+  // liveness, iterating backwards until nothing changes
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::size_t k = rpo.size(); k-- > 0; ) {
+      std::size_t b = rpo[k];
+      valueSet out = phiUses[b];
+      for (auto s : cfg.get_block(b).succs) {
+        valueSet merged;
+        std::set_union(out.begin(), out.end(), liveIn[s].begin(), liveIn[s].end(),
+                       std::back_inserter(merged));
+        out.swap(merged);
+      }
+      valueSet in;
+      std::set_difference(out.begin(), out.end(), kill[b].begin(), kill[b].end(),
+                          std::back_inserter(in));
+      valueSet merged;
+      std::set_union(in.begin(), in.end(), gen[b].begin(), gen[b].end(), std::back_inserter(merged));
+      if (out != liveOut[b] or merged != liveIn[b]) {
+        liveOut[b].swap(out);
+        liveIn[b].swap(merged);
+        changed = true;
+      }
+    }
+  }
+
+  // a value is live at a point if it is defined before and used after it
+  auto live_at = [&](int a, const site &p) -> bool {
+    const site &d = defSite[a];
+    if (d.block == p.block) {
+      if (d.index > p.index) return false;
+    }
+    else if (not cfg.dominates(d.block, p.block)) return false;
+    if (contains(liveOut[p.block], a)) return true;
+    for (auto &u : useSites[a])
+      if (u.block == p.block and u.index > p.index) return true;
+    return false;
+  };
+  auto interfere = [&](int a, int b) -> bool {
+    return a != b and (live_at(a, defSite[b]) or live_at(b, defSite[a]));
+  };
+
+  // variables whose versions are never live at the same time
+  std::map<operand, int> varIndex;
+  std::vector<int> varOf(value.size());
+  for (std::size_t v = 0; v < value.size(); ++v) {
+    operand var = get_variable(value[v]);
+    auto it = varIndex.insert(std::make_pair(var, int(varIndex.size()))).first;
+    varOf[v] = it->second;
+  }
+  std::vector<bool> conflict(varIndex.size(), false);
+  std::vector<int> liveVersions(varIndex.size(), 0);
+  for (auto b : rpo) {
+    valueSet live = liveOut[b];
+    for (auto v : live) ++liveVersions[varOf[v]];
+    const instructionList &code = cfg.get_block(b).instructions;
+    for (std::size_t k = code.size(); k-- > 0; ) {
+      const operand *d = code[k].get_def();
+      int v = d ? value_id(*d) : -1;
+      if (v >= 0) {
+        bool isLive = contains(live, v);
+        if (liveVersions[varOf[v]] - (isLive ? 1 : 0) > 0) conflict[varOf[v]] = true;
+        if (isLive) {
+          live.erase(std::lower_bound(live.begin(), live.end(), v));
+          --liveVersions[varOf[v]];
+        }
+      }
+      const operand *u[3];
+      int n = code[k].get_uses(u);
+      for (int j = 0; j < n; ++j) {
+        int w = value_id(*u[j]);
+        if (w >= 0 and not contains(live, w)) {
+          add_to(live, w);
+          ++liveVersions[varOf[w]];
+        }
+      }
+    }
+    for (auto &p : phis[b]) {
+      int v = value_id(p.def);
+      int others = liveVersions[varOf[v]] - (contains(live, v) ? 1 : 0);
+      if (others > 0) conflict[varOf[v]] = true;
+    }
+    for (auto v : live) --liveVersions[varOf[v]];
+  }
+
+  // t-code only takes temporaries as addresses ("*t", "t[i]"): the
+  // values used that way can not share a name with a variable
+  std::vector<bool> address(value.size(), false), entry(value.size(), false);
+  for (auto b : rpo)
+    for (auto &i : cfg.get_block(b).instructions) {
+      const operand *a = nullptr;
+      if (i.oper == instruction::_CLOAD or i.oper == instruction::_XLOAD) a = &i.arg1;
+      else if (i.oper == instruction::_LOADC or i.oper == instruction::_LOADX) a = &i.arg2;
+      int v = a ? value_id(*a) : -1;
+      if (v >= 0) address[v] = true;
+    }
+  for (std::size_t v = 0; v < value.size(); ++v) {
+    entry[v] = variable.find(value[v]) == variable.end();
+    if (address[v] and not get_variable(value[v]).is_temp()) conflict[varOf[v]] = true;
+  }
+
+  // classes of values sharing a name: first the versions of each
+  // variable without conflicts, then the values related by a phi
+  std::vector<int> parent(value.size()), preferred(value.size(), -1);
+  std::vector<std::vector<int>> members(value.size());
+  for (std::size_t v = 0; v < value.size(); ++v) {
+    parent[v] = v;
+    members[v].push_back(v);
+  }
+  auto join = [&](int keep, int other) {
+    parent[other] = keep;
+    members[keep].insert(members[keep].end(), members[other].begin(), members[other].end());
+    members[other].clear();
+    if (preferred[keep] < 0) preferred[keep] = preferred[other];
+    address[keep] = address[keep] or address[other];
+    entry[keep] = entry[keep] or entry[other];
+  };
+  std::map<int, int> groupOfVar;
+  for (std::size_t v = 0; v < value.size(); ++v) {
+    if (conflict[varOf[v]]) continue;
+    auto it = groupOfVar.find(varOf[v]);
+    if (it == groupOfVar.end()) {
+      groupOfVar[varOf[v]] = v;
+      preferred[v] = varOf[v];
+    }
+    else
+      join(find_root(parent, it->second), v);
+  }
+  const std::size_t maxChecks = 4096;
+  for (auto b : rpo)
+    for (auto &p : phis[b]) {
+      int d = find_root(parent, value_id(p.def));
+      for (std::size_t j = 0; j < p.args.size(); ++j) {
+        if (not cfg.is_reachable(cfg.get_block(b).preds[j])) continue;
+        int a = value_id(p.args[j]);
+        if (a < 0) continue;
+        a = find_root(parent, a);
+        if (a == d or members[a].size() * members[d].size() > maxChecks) continue;
+        if ((address[a] or address[d]) and (entry[a] or entry[d])) continue;
+        bool clash = false;
+        for (auto x : members[a])
+          for (auto y : members[d])
+            if (not clash and interfere(x, y)) clash = true;
+        if (not clash) join(d, a);
+      }
+    }
+
+  // name of each class: the variable of the value it has on entry, if
+  // any, else its preferred variable, else a new temporary
+  std::vector<operand> nameOfVar(varIndex.size());
+  for (auto &v : varIndex) nameOfVar[v.second] = v.first;
+  std::vector<operand> name(value.size());
+  for (std::size_t r = 0; r < value.size(); ++r) {
+    if (find_root(parent, r) != int(r)) continue;
+    operand n;
+    for (auto m : members[r])
+      if (variable.find(value[m]) == variable.end()) n = value[m];
+    if (n.empty() and preferred[r] >= 0) n = nameOfVar[preferred[r]];
+    if (n.empty() or (address[r] and not entry[r] and not n.is_temp())) n = new_temp();
+    for (auto m : members[r]) name[m] = n;
+  }
+  // (operands that are neither set nor read, like the scratch
+  // temporary of "writes", keep their name)
+  auto final_name = [&](const operand &o) -> operand {
+    auto it = id.find(o);
+    return it == id.end() ? o : name[it->second];
+  };
+
+  // phis whose arguments do not all share the name of the result
+  // are lowered to copies. When every edge needing a copy comes from a
+  // block with no other successor (and no conditional jump), the
+  // copies go at the end of those blocks ("direct" phis). Otherwise
+  // they go through a new temporary:
+  //     t = arg   at the end of each predecessor
+  //     def = t   at the start of the block
+  std::vector<std::vector<operand>> phiTemp(nb);
+  std::vector<std::vector<bool>> phiDirect(nb);
+  for (auto b : rpo)
+    for (auto &p : phis[b]) {
+      bool copies = false, direct = true;
+      int d = find_root(parent, value_id(p.def));
+      for (std::size_t j = 0; j < p.args.size(); ++j) {
+        const basicBlock &pred = cfg.get_block(cfg.get_block(b).preds[j]);
+        if (not cfg.is_reachable(pred.id)) continue;
+        int a = value_id(p.args[j]);
+        if (a >= 0 and find_root(parent, a) == d) continue;
+        copies = true;
+        const instruction *t = pred.get_terminator();
+        if (pred.succs.size() != 1 or (t != nullptr and t->oper == instruction::_FJUMP))
+          direct = false;
+      }
+      phiDirect[b].push_back(copies and direct);
+      phiTemp[b].push_back((copies and not direct) ? new_temp() : operand());
+    }
+
+  for (auto b : rpo) {
+    basicBlock &blk = cfg.get_block(b);
+    instructionList code;
+    code.reserve(blk.instructions.size() + phis[b].size());
+    std::size_t k = 0;
+    if (not blk.instructions.empty() and blk.instructions[0].oper == instruction::_LABEL)
+      code.append(blk.instructions[k++]);
+    for (std::size_t j = 0; j < phis[b].size(); ++j)
+      if (not phiTemp[b][j].empty())
+        code.append(instruction::LOAD(final_name(phis[b][j].def), phiTemp[b][j]));
+    for (; k < blk.instructions.size(); ++k) {
+      instruction i = blk.instructions[k];
+      for (operand *a : {&i.arg1, &i.arg2, &i.arg3})
+        *a = final_name(*a);
+      if (i.oper == instruction::_LOAD and i.arg1 == i.arg2) continue;
+      code.append(i);
+    }
+    // copies for the phis of the successors, before the final jump:
+    // first the ones to temporaries, then the direct ones (which
+    // behave as a parallel copy, so they are ordered to not overwrite
+    // a value still to be read, breaking cycles with a temporary)
+    instructionList copies;
+    std::vector<std::pair<operand, operand>> parallel;
+    for (auto s : blk.succs) {
+      const std::vector<std::size_t> &preds = cfg.get_block(s).preds;
+      std::size_t j = std::find(preds.begin(), preds.end(), b) - preds.begin();
+      for (std::size_t q = 0; q < phis[s].size(); ++q) {
+        operand src = final_name(phis[s][q].args[j]);
+        if (not phiTemp[s][q].empty())
+          copies.append(copy_of(phiTemp[s][q], src));
+        else if (phiDirect[s][q] and final_name(phis[s][q].def) != src)
+          parallel.push_back(std::make_pair(final_name(phis[s][q].def), src));
+      }
+    }
+    while (not parallel.empty()) {
+      std::size_t c = 0;
+      while (c < parallel.size() and
+             std::find_if(parallel.begin(), parallel.end(),
+                          [&](const std::pair<operand, operand> &x) { return x.second == parallel[c].first; })
+             != parallel.end())
+        ++c;
+      if (c == parallel.size()) {
+        operand t = new_temp();
+        copies.append(copy_of(t, parallel[0].second));
+        parallel[0].second = t;
+        continue;
+      }
+      copies.append(copy_of(parallel[c].first, parallel[c].second));
+      parallel.erase(parallel.begin() + c);
+    }
+    if (not copies.empty()) {
+      bool jump = not code.empty() and code.back().ends_block();
+      code.insert(code.end() - (jump ? 1 : 0), copies.begin(), copies.end());
+    }
+    blk.instructions = std::move(code);
+  }
+  for (auto &p : phis) p.clear();
+
+  return cfg.linearize();
+}
+
+
+////////////////////////////////////////////////////////////////////
+/// print (for debugging)
+
+std::string ssaForm::dump() const {
+  std::string s;
+  for (std::size_t b = 0; b < cfg.get_num_blocks(); ++b) {
+    const basicBlock &blk = cfg.get_block(b);
+    s += "block " + std::to_string(b) + "\n";
+    for (auto &p : phis[b]) {
+      s += "     " + p.def.dump() + " = phi(";
+      for (std::size_t j = 0; j < p.args.size(); ++j)
+        s += (j ? ", " : "") + p.args[j].dump();
+      s += ")\n";
+    }
+    for (auto &i : blk.instructions) s += "  " + i.dump() + "\n";
+  }
+  return s;
+}
@@ -0,0 +1,114 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    ssa - Static single assignment form of a t-code subroutine
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+#include "cfg.h"
+
+#include <map>
+#include <set>
+#include <vector>
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class ssaForm builds the SSA form of a subroutine on its control
+/// flow graph, and translates it back to plain t-code.
+///
+/// The renamed variables are all the temporaries and the scalar
+/// locals and parameters. Arrays (used through XLOAD/LOADX/ALOAD, or
+/// parameters passed by address) are memory and are not renamed;
+/// neither is "_result", which is read by "return".
+/// Every definition of a renamed variable gets a new temporary; the
+/// value a variable has on entry keeps the variable name. Phi
+/// functions are kept apart from the instructions of each block.
+///
+/// destruct() coalesces the names related by phis (and the versions
+/// of each variable) when their live ranges do not overlap, and
+/// lowers the remaining phis to LOAD copies.
+
+class ssaForm {
+public:
+  /// Class phi stores "def = phi(args)": one argument for each
+  /// predecessor of the block, in the same order as its preds
+  class phi {
+  public:
+    operand def;
+    std::vector<operand> args;
+  };
+
+  /// constructor: build SSA for the instructions of a subroutine
+  ssaForm(const subroutine &subr);
+
+  /// control flow graph (with the renamed instructions)
+  controlFlowGraph & get_cfg();
+  /// phis at the start of a block
+  std::vector<phi> & get_phis(std::size_t b);
+
+  /// variable is renamed into SSA (temporaries and scalar locals/params)
+  bool is_renamed(const operand &var) const;
+  /// variable of an SSA name (the name itself if it is not renamed)
+  operand get_variable(const operand &name) const;
+  /// operand names an SSA value: a temporary, or the value on entry
+  /// of a renamed variable
+  bool is_value(const operand &o) const;
+
+  /// a new temporary, not used yet in the subroutine
+  operand new_temp();
+
+  /// remove an edge of the graph, and the phi arguments that come
+  /// through it (get_cfg().update() must be called after the changes)
+  void remove_edge(std::size_t from, std::size_t to);
+  /// add an empty block before b for the edges from the given
+  /// predecessors (see controlFlowGraph::insert_block). The phis of b
+  /// get a single argument for it, merged by a new phi if needed.
+  std::size_t insert_block(std::size_t b, const std::vector<std::size_t> &from);
+  /// block where code can be placed to run once before a loop: the
+  /// only block entering the loop, if it has no other successor, or a
+  /// new block inserted before the header (and the graph is updated).
+  /// -1 if the loop is not entered from outside.
+  int get_preheader(const controlFlowGraph::loop &l);
+
+  /// back to plain t-code
+  instructionList destruct();
+
+  // print SSA form (for debugging)
+  std::string dump() const;
+
+private:
+  controlFlowGraph cfg;
+  std::vector<std::vector<phi>> phis;
+  /// renamed variables, and variable of each SSA name
+  std::set<operand> renamed;
+  std::map<operand, operand> variable;
+  int lastTemp;
+
+  void place_phis();
+  void rename();
+};
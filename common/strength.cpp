@@ -0,0 +1,255 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    strength - Strength reduction of induction variables
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "strength.h"
+
+#include <map>
+#include <algorithm>
+#include <vector>
+#include <utility>
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'strengthReduction'
+
+strengthReduction::strengthReduction(ssaForm &ssa) : ssa(ssa), cfg(ssa.get_cfg()) {}
+
+namespace {
+
+  // an instruction of a block (or phi -1-k)
+  struct site { std::size_t block; int index; };
+
+  // how an induction variable is used
+  typedef enum {ADDRESS, READ, WRITE, TEST, OTHER} useKind;
+
+}
+
+/// reduce one induction variable of the loop with the given header
+std::size_t strengthReduction::reduce(std::size_t header) {
+  int li = cfg.get_loop_of(header);
+  if (li < 0 or cfg.get_loops()[li].header != header) return 0;
+  controlFlowGraph::loop lp = cfg.get_loops()[li];
+
+  // definitions and uses of the values
+  std::map<operand, site> defs;
+  std::map<operand, std::vector<site>> uses;
+  for (auto b : cfg.get_reverse_postorder()) {
+    const std::vector<ssaForm::phi> &phis = ssa.get_phis(b);
+    for (std::size_t k = 0; k < phis.size(); ++k) {
+      defs[phis[k].def] = site{b, -1 - int(k)};
+      for (auto &a : phis[k].args) uses[a].push_back(site{b, -1 - int(k)});
+    }
+    const instructionList &code = cfg.get_block(b).instructions;
+    for (std::size_t k = 0; k < code.size(); ++k) {
+      const operand *u[3];
+      int n = code[k].get_uses(u);
+      for (int j = 0; j < n; ++j)
+        if (j == 0 or *u[j] != *u[j-1]) uses[*u[j]].push_back(site{b, int(k)});
+      const operand *d = code[k].get_def();
+      if (d != nullptr and ssa.is_value(*d)) defs[*d] = site{b, int(k)};
+    }
+  }
+  auto invariant = [&](const operand &o) -> bool {
+    if (not ssa.is_value(o)) return false;
+    auto it = defs.find(o);
+    return it == defs.end() or not lp.contains(it->second.block);
+  };
+  // an array: invariant address, or the name of a local array
+  auto array = [&](const operand &o) -> bool {
+    return invariant(o) or (o.is_name() and not ssa.is_value(o));
+  };
+  // an instruction whose result is not used (deadCodeElimination removes it)
+  auto unused = [&](const site &s) -> bool {
+    if (s.index < 0) return false;
+    const operand *d = cfg.get_block(s.block).instructions[s.index].get_def();
+    return d != nullptr and ssa.is_value(*d) and uses[*d].empty();
+  };
+  const basicBlock &head = cfg.get_block(header);
+
+  std::vector<ssaForm::phi> &phis = ssa.get_phis(header);
+  for (std::size_t k = 0; k < phis.size(); ++k) {
+    // i = phi(init, next), with the same init from outside and next from the latches
+    operand iv = phis[k].def, init, next;
+    bool ok = true;
+    for (std::size_t j = 0; j < head.preds.size() and ok; ++j) {
+      operand &v = lp.contains(head.preds[j]) ? next : init;
+      if (v.empty()) v = phis[k].args[j];
+      ok = v == phis[k].args[j];
+    }
+    if (not ok or init.empty() or next.empty()) continue;
+
+    // next = i + s, in the loop, with an invariant step s
+    auto d = defs.find(next);
+    if (d == defs.end() or d->second.index < 0 or not lp.contains(d->second.block)) continue;
+    site inc = d->second;
+    const instruction &incr = cfg.get_block(inc.block).instructions[inc.index];
+    if (incr.oper != instruction::_ADD) continue;
+    operand step = incr.arg2 == iv ? incr.arg3 : incr.arg2;
+    if ((incr.arg2 != iv and incr.arg3 != iv) or not invariant(step)) continue;
+
+    // classify the uses of i: arrays accessed, and other uses
+    std::vector<std::pair<site, useKind>> ivUses;
+    std::vector<operand> bases;
+    std::map<operand, int> addresses;
+    bool other = std::any_of(uses[next].begin(), uses[next].end(), [&](const site &s) {
+        return (s.block != header or s.index != -1 - int(k)) and not unused(s);
+      });
+    for (auto &s : uses[iv]) {
+      if ((s.block == inc.block and s.index == inc.index) or unused(s)) continue;
+      useKind kind = OTHER;
+      operand base;
+      if (s.index >= 0 and lp.contains(s.block)) {
+        const instruction &i = cfg.get_block(s.block).instructions[s.index];
+        switch (i.oper) {
+        case instruction::_ADD:
+          base = i.arg2 == iv ? i.arg3 : i.arg2;
+          if (base != iv and invariant(base)) kind = ADDRESS;
+          break;
+        case instruction::_LOADX:
+          base = i.arg2;
+          if (i.arg3 == iv and base != iv and array(base)) kind = READ;
+          break;
+        case instruction::_XLOAD:
+          base = i.arg1;
+          if (i.arg2 == iv and base != iv and i.arg3 != iv and array(base)) kind = WRITE;
+          break;
+        case instruction::_LT: case instruction::_LE: case instruction::_EQ: {
+          const operand &n = i.arg2 == iv ? i.arg3 : i.arg2;
+          if (n != iv and invariant(n)) kind = TEST;
+          break;
+        }
+        default:
+          break;
+        }
+      }
+      if (kind == OTHER) other = true;
+      else ivUses.push_back(std::make_pair(s, kind));
+      if (kind == ADDRESS or kind == READ or kind == WRITE) {
+        if (addresses.find(base) == addresses.end()) bases.push_back(base);
+        addresses[base] += kind == ADDRESS;
+      }
+    }
+
+    // pointers that save instructions: all of them, if i goes away
+    // (one increment per pointer, minus the address additions and the
+    // increment of i); otherwise those replacing several additions
+    std::vector<operand> chosen;
+    int saved = 0;
+    if (not other and not bases.empty()) {
+      chosen = bases;
+      saved = 1 - int(bases.size());
+      for (auto &b : bases) saved += addresses[b];
+    }
+    else
+      for (auto &b : bases)
+        if (addresses[b] > 1) {
+          chosen.push_back(b);
+          saved += addresses[b] - 1;
+        }
+    if (saved <= 0) continue;
+
+    // pointers start before the loop, and advance with i
+    int pre = ssa.get_preheader(lp);
+    if (pre < 0) return 0;
+    instructionList before;
+    // starting at 0, the pointers start at the base
+    bool zero = false;
+    auto di = defs.find(init);
+    if (di != defs.end() and di->second.index >= 0) {
+      const instruction &i = cfg.get_block(di->second.block).instructions[di->second.index];
+      zero = i.oper == instruction::_ILOAD and i.arg2 == operand::ICONST(0);
+    }
+    std::map<operand, operand> pointer, pointerNext, address;
+    std::map<operand, operand> limit;
+    for (auto &b : chosen) {
+      operand a = b;
+      if (not ssa.is_value(b)) {
+        a = ssa.new_temp();
+        before.append(instruction::ALOAD(a, b));
+      }
+      address[b] = a;
+      operand p0 = a;
+      if (not zero) {
+        p0 = ssa.new_temp();
+        before.append(instruction::ADD(p0, a, init));
+      }
+      pointer[b] = ssa.new_temp();
+      pointerNext[b] = ssa.new_temp();
+      ssaForm::phi p;
+      p.def = pointer[b];
+      for (auto pred : cfg.get_block(header).preds)
+        p.args.push_back(lp.contains(pred) ? pointerNext[b] : p0);
+      ssa.get_phis(header).push_back(p);
+    }
+
+    std::size_t count = 0;
+    for (auto &u : ivUses) {
+      instruction &i = cfg.get_block(u.first.block).instructions[u.first.index];
+      operand base = i.oper == instruction::_ADD ? (i.arg2 == iv ? i.arg3 : i.arg2) :
+                     i.oper == instruction::_LOADX ? i.arg2 : i.arg1;
+      if (u.second == TEST) {
+        if (other) continue;
+        const operand &b = chosen[0];
+        operand n = i.arg2 == iv ? i.arg3 : i.arg2;
+        if (limit.find(n) == limit.end()) {
+          limit[n] = ssa.new_temp();
+          before.append(instruction::ADD(limit[n], address[b], n));
+        }
+        if (i.arg2 == iv) i = instruction(i.oper, i.arg1, pointer[b], limit[n]);
+        else              i = instruction(i.oper, i.arg1, limit[n], pointer[b]);
+      }
+      else if (pointer.find(base) == pointer.end()) continue;
+      else if (u.second == ADDRESS) i = instruction::LOAD(i.arg1, pointer[base]);
+      else if (u.second == READ)    i = instruction::LOADC(i.arg1, pointer[base]);
+      else                          i = instruction::CLOAD(pointer[base], i.arg3);
+      ++count;
+    }
+
+    instructionList &code = cfg.get_block(pre).instructions;
+    bool jump = not code.empty() and code.back().ends_block();
+    code.insert(code.end() - (jump ? 1 : 0), before.begin(), before.end());
+    instructionList &incCode = cfg.get_block(inc.block).instructions;
+    for (auto &b : chosen)
+      incCode.insert(incCode.begin() + inc.index + 1,
+                     instruction::ADD(pointerNext[b], pointer[b], step));
+    return count;
+  }
+  return 0;
+}
+
+std::size_t strengthReduction::run() {
+  // headers of the loops, inner loops first
+  std::vector<std::size_t> headers;
+  for (auto &l : cfg.get_loops())
+    headers.push_back(l.header);
+  std::size_t count = 0;
+  for (std::size_t k = headers.size(); k-- > 0; )
+    for (std::size_t n = reduce(headers[k]); n > 0; n = reduce(headers[k]))
+      count += n;
+  return count;
+}
@@ -0,0 +1,67 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    strength - Strength reduction of induction variables
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+#include "ssa.h"
+
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class strengthReduction finds the induction variables of the
+/// loops (a header phi "i" increased by the same invariant step "s"
+/// in each iteration) used to access arrays, and gives each array
+/// a pointer that walks it: "p = base + i" before the loop, and
+/// "p = p + s" next to the increment of i. Then
+///   - "t = base + i" (address of an element) is p
+///   - "x = base[i]" (LOADX) is "x = *p" (LOADC)
+///   - "base[i] = x" (XLOAD) is "*p = x" (CLOAD)
+///   - "i < n" (or <=, ==) is "p < base + n", with the limit computed
+///     before the loop
+/// When i is only used in these ways, it is no longer needed
+/// (deadCodeElimination removes it). Since t-code indexes arrays in
+/// one instruction, a loop is only changed when this saves
+/// instructions in each iteration.
+
+class strengthReduction {
+public:
+  /// constructor
+  strengthReduction(ssaForm &ssa);
+
+  /// reduce the induction variables, and return the number of
+  /// instructions changed
+  std::size_t run();
+
+private:
+  ssaForm &ssa;
+  controlFlowGraph &cfg;
+
+  std::size_t reduce(std::size_t header);
+};
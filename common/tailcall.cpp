@@ -0,0 +1,120 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    tailcall - Elimination of self tail calls
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "tailcall.h"
+#include "inliner.h"
+
+#include <set>
+#include <vector>
+#include <algorithm>
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'tailCallElimination'
+
+tailCallElimination::tailCallElimination() {}
+
+std::size_t tailCallElimination::run(subroutine &subr) {
+  std::vector<operand> scalars;
+  for (auto &v : subr.vars) {
+    if (v.size > 1) return 0;
+    scalars.push_back(operand(v.name));
+  }
+  for (auto &i : subr.get_instructions()) {
+    const operand &a = i.oper == instruction::_XLOAD ? i.arg1 : i.arg2;
+    if ((i.oper == instruction::_ALOAD or i.oper == instruction::_LOADX or
+         i.oper == instruction::_XLOAD) and std::find(scalars.begin(), scalars.end(), a) != scalars.end())
+      return 0;
+  }
+  std::set<operand> params;
+  for (auto &p : subr.params) params.insert(operand(p.name));
+  bool hasResult = not subr.params.empty() and subr.params.front().name == "_result";
+  std::size_t nParams = subr.params.size();
+
+  instructionList code = subr.get_instructions();
+  int lastTemp = 0;
+  for (auto &i : code)
+    for (const operand *o : {&i.arg1, &i.arg2, &i.arg3})
+      if (o->is_temp()) lastTemp = std::max(lastTemp, o->get_value());
+
+  operand labelStart = operand::LABEL("tailRecursion");
+  std::size_t count = 0;
+  std::vector<std::size_t> pushes;
+  for (std::size_t pc = 0; pc < code.size(); ++pc) {
+    if (code[pc].oper != instruction::_CALL or code[pc].arg1.get_name() != subr.get_name() or
+        not inliner::find_pushes(code, pc, subr, pushes))
+      continue;
+    // the result is returned right away (the code after the call,
+    // that other paths may reach through its labels, is kept)
+    std::size_t after = pc + nParams + 1;
+    if (hasResult) {
+      if (after == code.size() or code[after].oper != instruction::_LOAD or
+          code[after].arg1 != operand("_result") or code[after].arg2 != code[pc+nParams].arg1)
+        continue;
+      ++after;
+    }
+    std::size_t ret = after;
+    while (ret < code.size() and code[ret].oper == instruction::_LABEL) ++ret;
+    if (ret == code.size() or code[ret].oper != instruction::_RETURN) continue;
+
+    // arguments into temporaries, then into the parameters
+    instructionList result, assign;
+    std::size_t next = 0;
+    std::size_t k = 0;
+    for (auto &p : subr.params) {
+      result.insert(result.end(), code.begin() + next, code.begin() + pushes[k]);
+      // an array parameter passed on is its value (the address it
+      // holds), not the address of the parameter
+      for (std::size_t j = result.size() - (pushes[k] - next); j < result.size(); ++j)
+        if (result[j].oper == instruction::_ALOAD and params.count(result[j].arg2))
+          result[j] = instruction::LOAD(result[j].arg1, result[j].arg2);
+      if (p.name != "_result") {
+        operand t = operand::TEMP(++lastTemp);
+        result.append(instruction::LOAD(t, code[pushes[k]].arg1));
+        assign.append(instruction::LOAD(operand(p.name), t));
+      }
+      next = pushes[k++] + 1;
+    }
+    result.insert(result.end(), code.begin() + next, code.begin() + pc);
+    result.append(std::move(assign));
+    for (auto &v : scalars)
+      result.append(instruction::ILOAD(v, operand::ICONST(0)));
+    result.append(instruction::UJUMP(labelStart));
+    pc = result.size() - 1;
+    result.insert(result.end(), code.begin() + after, code.end());
+    code = std::move(result);
+    ++count;
+  }
+
+  if (count > 0) {
+    code.insert(code.begin(), instruction::LABEL(labelStart));
+    subr.set_instructions(std::move(code));
+    subr.finalize();
+  }
+  return count;
+}
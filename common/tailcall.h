@@ -0,0 +1,54 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    tailcall - Elimination of self tail calls
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include "code.h"
+
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class tailCallElimination turns the calls of a subroutine to
+/// itself whose result is returned directly ("return f(...)", or a
+/// call right before the end of a procedure) into a jump to its
+/// start. The arguments are computed into temporaries as they were
+/// pushed, then copied to the parameters, and the scalar locals are
+/// set back to 0, as in a new call. Recursion of this kind then runs
+/// as a loop, in constant stack. Subroutines with local arrays are
+/// left as they are (they would have to be cleared).
+
+class tailCallElimination {
+public:
+  /// constructor
+  tailCallElimination();
+
+  /// remove the self tail calls of a subroutine, and return how many
+  std::size_t run(subroutine &subr);
+};
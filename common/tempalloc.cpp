@@ -0,0 +1,181 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    tempalloc - Reuse of temporaries by liveness
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "tempalloc.h"
+#include "cfg.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <vector>
+#include <utility>
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'temporaryAllocation'
+
+temporaryAllocation::temporaryAllocation() : numBefore(0), numAfter(0) {}
+
+std::size_t temporaryAllocation::get_num_before() const { return numBefore; }
+std::size_t temporaryAllocation::get_num_after() const { return numAfter; }
+
+namespace {
+
+  // sorted vectors used as sets of temporaries
+  typedef std::vector<int> tempSet;
+
+  void add_to(tempSet &s, int t) {
+    auto it = std::lower_bound(s.begin(), s.end(), t);
+    if (it == s.end() or *it != t) s.insert(it, t);
+  }
+
+}
+
+std::size_t temporaryAllocation::run(subroutine &subr) {
+  controlFlowGraph cfg(subr);
+  std::size_t nb = cfg.get_num_blocks();
+
+  // number the temporaries in order of first appearance
+  std::map<operand, int> index;
+  std::vector<operand> temps;
+  for (std::size_t b = 0; b < nb; ++b)
+    for (auto &i : cfg.get_block(b).instructions)
+      for (const operand *a : {&i.arg1, &i.arg2, &i.arg3})
+        if (a->is_temp() and index.insert(std::make_pair(*a, int(temps.size()))).second)
+          temps.push_back(*a);
+  std::size_t n = temps.size();
+  numBefore = numAfter = n;
+  if (n == 0) return 0;
+
+  // uses before any definition (gen) and definitions (kill) of each block
+  std::vector<tempSet> gen(nb), kill(nb), liveIn(nb), liveOut(nb);
+  for (std::size_t b = 0; b < nb; ++b)
+    for (auto &i : cfg.get_block(b).instructions) {
+      const operand *u[3];
+      int k = i.get_uses(u);
+      for (int j = 0; j < k; ++j)
+        if (u[j]->is_temp()) {
+          int t = index[*u[j]];
+          if (not std::binary_search(kill[b].begin(), kill[b].end(), t)) add_to(gen[b], t);
+        }
+      const operand *d = i.get_def();
+      if (d != nullptr and d->is_temp()) add_to(kill[b], index[*d]);
+    }
+
+  // liveness, iterating backwards until nothing changes
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::size_t b = nb; b-- > 0; ) {
+      tempSet out;
+      for (auto s : cfg.get_block(b).succs) {
+        tempSet merged;
+        std::set_union(out.begin(), out.end(), liveIn[s].begin(), liveIn[s].end(),
+                       std::back_inserter(merged));
+        out.swap(merged);
+      }
+      tempSet in, merged;
+      std::set_difference(out.begin(), out.end(), kill[b].begin(), kill[b].end(),
+                          std::back_inserter(in));
+      std::set_union(in.begin(), in.end(), gen[b].begin(), gen[b].end(), std::back_inserter(merged));
+      if (out != liveOut[b] or merged != liveIn[b]) {
+        liveOut[b].swap(out);
+        liveIn[b].swap(merged);
+        changed = true;
+      }
+    }
+  }
+
+  // interferences: a definition with the temporaries live after it
+  std::vector<std::vector<int>> neighbours(n);
+  std::vector<bool> isLive(n, false);
+  std::vector<int> live;
+  auto interfere = [&](int a, int b) {
+    neighbours[a].push_back(b);
+    neighbours[b].push_back(a);
+  };
+  for (std::size_t b = 0; b < nb; ++b) {
+    for (auto t : live) isLive[t] = false;
+    live = liveOut[b];
+    for (auto t : live) isLive[t] = true;
+    const instructionList &code = cfg.get_block(b).instructions;
+    for (std::size_t k = code.size(); k-- > 0; ) {
+      const operand *d = code[k].get_def();
+      if (d != nullptr and d->is_temp()) {
+        int t = index[*d];
+        for (auto l : live)
+          if (l != t) interfere(t, l);
+        if (isLive[t]) {
+          isLive[t] = false;
+          live.erase(std::find(live.begin(), live.end(), t));
+        }
+      }
+      const operand *u[3];
+      int m = code[k].get_uses(u);
+      for (int j = 0; j < m; ++j)
+        if (u[j]->is_temp()) {
+          int t = index[*u[j]];
+          if (not isLive[t]) {
+            isLive[t] = true;
+            live.push_back(t);
+          }
+        }
+    }
+    // temporaries read before being set are all alive on entry
+    if (b == 0)
+      for (std::size_t x = 0; x < live.size(); ++x)
+        for (std::size_t y = x + 1; y < live.size(); ++y)
+          interfere(live[x], live[y]);
+  }
+
+  // greedy coloring in order of first appearance
+  std::vector<int> color(n, -1), usedBy(n, -1);
+  int numColors = 0;
+  for (std::size_t t = 0; t < n; ++t) {
+    for (auto x : neighbours[t])
+      if (color[x] >= 0) usedBy[color[x]] = t;
+    int c = 0;
+    while (usedBy[c] == int(t)) ++c;
+    color[t] = c;
+    numColors = std::max(numColors, c + 1);
+  }
+
+  // renumber (copies between temporaries that share a number go away)
+  instructionList code;
+  code.reserve(subr.get_instructions().size());
+  for (auto i : subr.get_instructions()) {
+    for (operand *a : {&i.arg1, &i.arg2, &i.arg3})
+      if (a->is_temp())
+        *a = operand::TEMP(color[index[*a]] + 1);
+    if (i.oper != instruction::_LOAD or i.arg1 != i.arg2) code.append(i);
+  }
+  subr.set_instructions(std::move(code));
+  subr.finalize();
+  numAfter = numColors;
+  return numBefore - numAfter;
+}
@@ -0,0 +1,63 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    tempalloc - Reuse of temporaries by liveness
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class temporaryAllocation renumbers the temporaries of a
+/// subroutine so that temporaries that are never live at the same
+/// time share a number, and each tvm frame gets fewer slots.
+///
+/// Liveness is computed on the control flow graph; two temporaries
+/// interfere when one is defined while the other is live. The
+/// temporaries are then colored greedily, in the order of their
+/// first appearance (close to linear scan, since most temporaries
+/// live inside one expression), and renumbered %1, %2, ... Copies
+/// left between two temporaries with the same number are removed.
+
+class temporaryAllocation {
+public:
+  /// constructor
+  temporaryAllocation();
+
+  /// renumber the temporaries of a subroutine, and return how many
+  /// fewer temporaries it uses
+  std::size_t run(subroutine &subr);
+
+  /// temporaries used before and after the last run
+  std::size_t get_num_before() const;
+  std::size_t get_num_after() const;
+
+private:
+  std::size_t numBefore, numAfter;
+};
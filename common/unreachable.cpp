@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    unreachable - Removal of the blocks that can not be reached
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+
+#include "unreachable.h"
+
+#include <vector>
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'unreachableCode'
+
+unreachableCode::unreachableCode(ssaForm &ssa) : ssa(ssa), cfg(ssa.get_cfg()) {}
+
+std::size_t unreachableCode::run() {
+  std::size_t count = 0;
+  bool changed = false;
+  for (std::size_t b = 0; b < cfg.get_num_blocks(); ++b) {
+    if (cfg.is_reachable(b)) continue;
+    basicBlock &blk = cfg.get_block(b);
+    changed = changed or not blk.instructions.empty() or not blk.succs.empty();
+    count += blk.instructions.size();
+    blk.instructions.clear();
+    ssa.get_phis(b).clear();
+    // the edges to reachable blocks take their phi arguments with them
+    while (not blk.succs.empty())
+      ssa.remove_edge(b, blk.succs.back());
+    blk.fallthrough = -1;
+  }
+  if (changed) cfg.update();
+  return count;
+}
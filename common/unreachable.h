@@ -0,0 +1,58 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    unreachable - Removal of the blocks that can not be reached
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include "code.h"
+#include "ssa.h"
+
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class unreachableCode removes the blocks that can not be reached
+/// from the entry of the subroutine: the code after a "return" or a
+/// "goto" that no jump leads to (such as the "return" at the end of a
+/// function whose last statement returns), and the blocks left
+/// unconnected when constant folding removes a branch. Their labels
+/// go too, since only other unreachable blocks jump to them.
+
+class unreachableCode {
+public:
+  /// constructor
+  unreachableCode(ssaForm &ssa);
+
+  /// empty the unreachable blocks, and return the number of
+  /// instructions removed
+  std::size_t run();
+
+private:
+  ssaForm &ssa;
+  controlFlowGraph &cfg;
+};
@@ -0,0 +1,270 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    unroll - Unrolling of the loops with a known number of iterations
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+
+#include "unroll.h"
+
+#include <vector>
+#include <climits>
+
+
+// the copies of a loop body (labels apart) may add up to this number
+// of instructions
+static const std::size_t MAX_UNROLLED_SIZE = 64;
+// no more loops are unrolled in a subroutine that reaches this size
+static const std::size_t MAX_SUBROUTINE_SIZE = 2000;
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'loopUnrolling'
+
+loopUnrolling::loopUnrolling(std::size_t factor) : factor(factor), copies(0) {}
+
+std::size_t loopUnrolling::run(subroutine &subr) {
+  if (factor < 2) return 0;
+  const instructionList &code = subr.get_instructions();
+  numDefs.clear();
+  lastDef.clear();
+  for (auto &i : code)
+    if (const operand *d = i.get_def()) {
+      ++numDefs[*d];
+      lastDef[*d] = &i;
+    }
+
+  controlFlowGraph cfg(code);
+  const std::vector<controlFlowGraph::loop> &loops = cfg.get_loops();
+  std::size_t size = code.size();
+  std::size_t count = 0;
+  // copies of the body before the loop, and in the loop (0: no loop left)
+  std::map<std::size_t, std::pair<std::size_t, std::size_t>> unrolled;
+  for (std::size_t k = 0; k < loops.size() and size < MAX_SUBROUTINE_SIZE; ++k) {
+    const controlFlowGraph::loop &l = loops[k];
+    long long n;
+    if (not trip_count(cfg, l, n)) continue;
+    std::size_t bodySize = 0;
+    for (auto b : l.blocks)
+      for (auto &i : cfg.get_block(b).instructions)
+        if (i.oper != instruction::_LABEL) ++bodySize;
+
+    std::pair<std::size_t, std::size_t> shape(0, 0);
+    if (n * bodySize <= MAX_UNROLLED_SIZE)
+      shape.first = n;
+    else
+      for (std::size_t f = factor; f >= 2 and shape.second == 0; --f)
+        if ((f + n % f) * bodySize <= MAX_UNROLLED_SIZE)
+          shape = std::make_pair(std::size_t(n % f), f);
+    if (shape.first + shape.second == 0) continue;
+    unrolled[l.header] = shape;
+    size += (shape.first + shape.second - 1) * bodySize;
+    ++count;
+  }
+  if (count == 0) return 0;
+
+  // the loops are replaced in place: their blocks are consecutive
+  instructionList result;
+  result.reserve(size);
+  for (std::size_t b = 0; b < cfg.get_num_blocks(); ++b) {
+    auto it = unrolled.find(b);
+    if (it == unrolled.end()) {
+      result.append(cfg.get_block(b).instructions);
+      continue;
+    }
+    const controlFlowGraph::loop &l = loops[cfg.get_loop_of(b)];
+    // jumps from outside to the loop reach the first copy
+    operand start = cfg.get_block(b).get_label();
+    result.append(instruction::LABEL(start));
+    for (std::size_t c = 0; c < it->second.first; ++c)
+      result.append(copy_body(cfg, l, operand()));
+    if (it->second.second > 0) {
+      operand header = operand::LABEL(start.dump() + "_unr", ++copies);
+      result.append(instruction::LABEL(header));
+      for (std::size_t c = 1; c < it->second.second; ++c)
+        result.append(copy_body(cfg, l, operand()));
+      result.append(copy_body(cfg, l, header));
+    }
+    b = l.blocks.back();
+  }
+  subr.set_instructions(std::move(result));
+  subr.finalize();
+  return count;
+}
+
+/// number of times the body of the loop runs once entered, if it has
+/// the shape described in unroll.h and is the same on every entry
+bool loopUnrolling::trip_count(const controlFlowGraph &cfg, const controlFlowGraph::loop &l,
+                               long long &count) const {
+  // an innermost loop, with consecutive blocks, that is left only
+  // when the test at the end of the latch fails
+  std::size_t header = l.header, latch = l.blocks.back();
+  if (l.latches.size() != 1 or l.latches[0] != latch or
+      latch - header + 1 != l.blocks.size() or cfg.get_block(header).get_label().empty())
+    return false;
+  for (auto b : l.blocks) {
+    if (cfg.get_loop_of(b) != cfg.get_loop_of(header)) return false;
+    if (b == latch) continue;
+    for (auto s : cfg.get_block(b).succs)
+      if (not l.contains(s)) return false;
+  }
+  const basicBlock &last = cfg.get_block(latch);
+  const instruction *jump = last.get_terminator();
+  if (jump == nullptr or jump->oper != instruction::_FJUMP or
+      jump->arg2 != cfg.get_block(header).get_label() or last.fallthrough < 0)
+    return false;
+
+  // definitions inside the loop
+  std::map<operand, std::pair<std::size_t, std::size_t>> defIn;
+  std::map<operand, int> numDefsIn;
+  for (auto b : l.blocks) {
+    const instructionList &code = cfg.get_block(b).instructions;
+    for (std::size_t k = 0; k < code.size(); ++k)
+      if (const operand *d = code[k].get_def()) {
+        ++numDefsIn[*d];
+        defIn[*d] = std::make_pair(b, k);
+      }
+  }
+  auto num_defs = [](const std::map<operand, int> &m, const operand &o) {
+    auto it = m.find(o);
+    return it == m.end() ? 0 : it->second;
+  };
+  // value of an operand that is the same on every iteration
+  auto constant_of = [&](const operand &o, long long &v) -> bool {
+    if (num_defs(numDefs, o) == 1 and lastDef.at(o)->oper == instruction::_ILOAD) {
+      v = lastDef.at(o)->arg2.get_value();
+      return true;
+    }
+    return num_defs(numDefsIn, o) == 0 and entry_value(cfg, l, o, v);
+  };
+
+  // the test: "c = a < b" or "c = a <= b", going on while c is false
+  const instruction *test = nullptr;
+  std::size_t testPos = 0;
+  for (std::size_t k = 0; k + 1 < last.instructions.size(); ++k) {
+    const operand *d = last.instructions[k].get_def();
+    if (d != nullptr and *d == jump->arg1) {
+      test = &last.instructions[k];
+      testPos = k;
+    }
+  }
+  if (test == nullptr or (test->oper != instruction::_LT and test->oper != instruction::_LE))
+    return false;
+
+  // the counter: one side of the test, set once in each iteration
+  // before it, from its previous value and a constant step
+  for (bool counterLeft : {true, false}) {
+    const operand &i = counterLeft ? test->arg2 : test->arg3;
+    const operand &other = counterLeft ? test->arg3 : test->arg2;
+    long long bound, step, start;
+    if (num_defs(numDefsIn, i) != 1 or not constant_of(other, bound)) continue;
+    std::pair<std::size_t, std::size_t> pos = defIn[i];
+    if (pos.first == latch ? pos.second > testPos : not cfg.dominates(pos.first, latch)) continue;
+    const instruction *update = &cfg.get_block(pos.first).instructions[pos.second];
+    if (update->oper == instruction::_LOAD) {
+      if (num_defs(numDefs, update->arg2) != 1 or num_defs(numDefsIn, update->arg2) != 1) continue;
+      std::pair<std::size_t, std::size_t> p = defIn[update->arg2];
+      update = &cfg.get_block(p.first).instructions[p.second];
+    }
+    if (update->oper == instruction::_ADD and update->arg2 == i and constant_of(update->arg3, step)) ;
+    else if (update->oper == instruction::_ADD and update->arg3 == i and constant_of(update->arg2, step)) ;
+    else if (update->oper == instruction::_SUB and update->arg2 == i and constant_of(update->arg3, step))
+      step = -step;
+    else continue;
+    if (step == 0 or not entry_value(cfg, l, i, start)) continue;
+
+    // c = i < bound goes on while i >= bound, c = i <= bound while
+    // i > bound, and the other way round when i is on the right; the
+    // loop goes on while i < limit (or i > limit, going down)
+    bool up = not counterLeft;
+    long long limit = counterLeft ? (test->oper == instruction::_LT ? bound - 1 : bound)
+                                  : (test->oper == instruction::_LT ? bound + 1 : bound);
+    if (not up) { start = -start; step = -step; limit = -limit; }
+    if (step < 0) continue;
+    // the body runs once, and then again while start + m*step < limit
+    count = 1 + (limit - start > step ? (limit - start - 1) / step : 0);
+    long long end = start + count * step;
+    if (up ? end > INT_MAX : -end < INT_MIN) continue;
+    return true;
+  }
+  return false;
+}
+
+/// constant value of x when the loop is entered, set in the blocks
+/// that lead to it through a single path
+bool loopUnrolling::entry_value(const controlFlowGraph &cfg, const controlFlowGraph::loop &l,
+                                const operand &x, long long &value) const {
+  int b = -1;
+  for (auto p : cfg.get_block(l.header).preds)
+    if (not l.contains(p)) {
+      if (b >= 0) return false;
+      b = p;
+    }
+  for (int steps = 0; b >= 0 and steps < 32; ++steps) {
+    const instructionList &code = cfg.get_block(b).instructions;
+    for (std::size_t k = code.size(); k-- > 0; ) {
+      const operand *d = code[k].get_def();
+      if (d == nullptr or *d != x) continue;
+      const instruction *i = &code[k];
+      if (i->oper == instruction::_LOAD and numDefs.count(i->arg2) and numDefs.at(i->arg2) == 1)
+        i = lastDef.at(i->arg2);
+      if (i->oper != instruction::_ILOAD) return false;
+      value = i->arg2.get_value();
+      return true;
+    }
+    const std::vector<std::size_t> &preds = cfg.get_block(b).preds;
+    b = preds.size() == 1 ? int(preds[0]) : -1;
+  }
+  return false;
+}
+
+/// a copy of the body of the loop, with its own labels, and the test
+/// at the end jumping to backTo (or removed, if it is empty)
+instructionList loopUnrolling::copy_body(const controlFlowGraph &cfg, const controlFlowGraph::loop &l,
+                                         const operand &backTo) {
+  ++copies;
+  operand start = cfg.get_block(l.header).get_label();
+  auto rename = [&](const operand &lab) { return operand::LABEL(lab.dump() + "_unr", copies); };
+  instructionList body;
+  for (auto b : l.blocks)
+    for (auto i : cfg.get_block(b).instructions) {
+      if (i.oper == instruction::_LABEL) {
+        if (i.arg1 == start) continue;
+        i.arg1 = rename(i.arg1);
+      }
+      else if (i.oper == instruction::_UJUMP)
+        i.arg1 = rename(i.arg1);
+      else if (i.oper == instruction::_FJUMP) {
+        if (i.arg2 == start) {
+          if (backTo.empty()) continue;
+          i.arg2 = backTo;
+        }
+        else
+          i.arg2 = rename(i.arg2);
+      }
+      body.append(i);
+    }
+  return body;
+}
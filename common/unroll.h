@@ -0,0 +1,77 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    unroll - Unrolling of the loops with a known number of iterations
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include "code.h"
+#include "cfg.h"
+
+#include <map>
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class loopUnrolling copies the body of the innermost loops whose
+/// number of iterations is known at compile time. It works on the
+/// t-code of the rotated loops (see CodeGenVisitor::visitWhileStmt),
+/// before the SSA passes, which then fold the copies:
+///     label L; body; c = a < b; ifFalse c goto L
+/// where the body sets a counter i once per iteration ("i = i + k")
+/// before the test, the other side of the test is a constant, and
+/// the value of i when entering the loop is a constant too.
+///
+/// A loop of n iterations whose n copies fit in the size budget is
+/// replaced by them (without the tests). Otherwise it is unrolled by
+/// the given factor f (or a smaller one that fits): n mod f copies
+/// come first, as the remainder, and then a loop with f copies that
+/// tests the condition only after the last one.
+
+class loopUnrolling {
+public:
+  /// constructor (a factor below 2 leaves the loops as they are)
+  loopUnrolling(std::size_t factor);
+
+  /// unroll the loops of a subroutine, and return how many
+  std::size_t run(subroutine &subr);
+
+private:
+  std::size_t factor;
+  /// copies made so far (to make labels unique)
+  int copies;
+  /// definitions of each name in the subroutine
+  std::map<operand, int> numDefs;
+  std::map<operand, const instruction *> lastDef;
+
+  bool trip_count(const controlFlowGraph &cfg, const controlFlowGraph::loop &l,
+                  long long &count) const;
+  bool entry_value(const controlFlowGraph &cfg, const controlFlowGraph::loop &l,
+                   const operand &x, long long &value) const;
+  instructionList copy_body(const controlFlowGraph &cfg, const controlFlowGraph::loop &l,
+                            const operand &backTo);
+};
@@ -0,0 +1,140 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    valuenum - Global value numbering on SSA form
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "valuenum.h"
+
+#include <map>
+#include <vector>
+#include <utility>
+
+
+////////////////////////////////////////////////////////////////////
+/// Implementation for class 'valueNumbering'
+
+namespace {
+
+  // an expression: operation, operands, and the state of memory
+  // when it reads memory (0 otherwise)
+  struct expression {
+    instruction::Operation oper;
+    operand a, b;
+    int memory;
+
+    bool operator<(const expression &e) const {
+      if (oper != e.oper) return oper < e.oper;
+      if (memory != e.memory) return memory < e.memory;
+      if (a != e.a) return a < e.a;
+      return b < e.b;
+    }
+  };
+
+  bool commutative(instruction::Operation op) {
+    return op == instruction::_ADD or op == instruction::_MUL or op == instruction::_EQ or
+           op == instruction::_AND or op == instruction::_OR or op == instruction::_FADD or
+           op == instruction::_FMUL or op == instruction::_FEQ;
+  }
+
+}
+
+valueNumbering::valueNumbering(ssaForm &ssa) : ssa(ssa), cfg(ssa.get_cfg()) {}
+
+std::size_t valueNumbering::run() {
+  std::map<expression, operand> available;
+  // values that are copies of other values stand for them in expressions
+  std::map<operand, operand> copyOf;
+  auto canonical = [&](const operand &o) -> operand {
+    auto it = copyOf.find(o);
+    return it == copyOf.end() ? o : it->second;
+  };
+  int memoryState = 0;
+  std::size_t count = 0;
+
+  // explicit stack of (block, next child, expressions added)
+  struct frame { std::size_t block; std::size_t child; std::vector<expression> added; };
+  std::vector<frame> walk;
+  walk.push_back(frame{0, 0, std::vector<expression>()});
+  bool entering = true;
+  while (not walk.empty()) {
+    frame &f = walk.back();
+    if (entering) {
+      int memory = ++memoryState;  // unknown on entry to the block
+      for (auto &i : cfg.get_block(f.block).instructions) {
+        const operand *d = i.get_def();
+        bool pure = d != nullptr and ssa.is_value(*d) and not i.has_side_effects();
+        if (pure and i.oper == instruction::_LOAD and ssa.is_value(i.arg2)) {
+          // copies of the same name (the address of an array parameter)
+          // all become copies of the first one, a temporary that can
+          // replace them everywhere
+          operand src = canonical(i.arg2);
+          copyOf[*d] = src;
+          if (src.is_temp()) continue;
+          expression e{i.oper, src, operand(), 0};
+          auto it = available.find(e);
+          if (it != available.end()) i.arg2 = it->second;
+          else {
+            available[e] = *d;
+            f.added.push_back(e);
+          }
+        }
+        else if (pure and i.oper != instruction::_LOAD and i.oper != instruction::_POP) {
+          expression e{i.oper, canonical(i.arg2), canonical(i.arg3), 0};
+          if (commutative(i.oper) and e.b < e.a) std::swap(e.a, e.b);
+          bool reads = i.reads_memory();
+          if (i.oper != instruction::_ALOAD)
+            for (const operand *a : {&i.arg2, &i.arg3})
+              reads = reads or (a->is_name() and not ssa.is_value(*a));
+          if (reads) e.memory = memory;
+          auto it = available.find(e);
+          if (it != available.end()) {
+            i = instruction::LOAD(*d, it->second);
+            ++count;
+          }
+          else {
+            available[e] = *d;
+            f.added.push_back(e);
+          }
+        }
+        else if (i.writes_memory() or (d != nullptr and not ssa.is_value(*d)))
+          memory = ++memoryState;
+      }
+    }
+    const std::vector<std::size_t> &children = cfg.get_dom_children(f.block);
+    if (f.child < children.size()) {
+      std::size_t c = children[f.child++];
+      walk.push_back(frame{c, 0, std::vector<expression>()});
+      entering = true;
+    }
+    else {
+      for (auto &e : f.added)
+        available.erase(e);
+      walk.pop_back();
+      entering = false;
+    }
+  }
+  return count;
+}
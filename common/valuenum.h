@@ -0,0 +1,61 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    valuenum - Global value numbering on SSA form
+//
+//    Copyright (C) 2019  Universitat Politecnica de Catalunya
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU General Public License
+//    as published by the Free Software Foundation; either version 3
+//    of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Affero General Public License for more details.
+//
+//    You should have received a copy of the GNU Affero General Public
+//    License along with this library; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+//    contact: José Miguel Rivero (rivero@cs.upc.edu)
+//             Computer Science Department
+//             Universitat Politecnica de Catalunya
+//             despatx Omega.110 - Campus Nord UPC
+//             08034 Barcelona.  SPAIN
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+#include "ssa.h"
+
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////////////
+/// Class valueNumbering finds the instructions that compute again a
+/// value already computed by an instruction that dominates them
+/// (walking the dominator tree with a scoped table of expressions),
+/// and turns them into copies of the first result; copyPropagation
+/// and deadCodeElimination then remove the copies.
+///
+/// Expressions are keyed by operation and SSA operands (sorted for
+/// commutative operations), so they are equal in any block. Reads of
+/// memory (array elements, values through addresses, and names that
+/// are not renamed) are only reused inside a block and until the next
+/// store (XLOAD, CLOAD), call, or write of a name that is not renamed.
+
+class valueNumbering {
+public:
+  /// constructor
+  valueNumbering(ssaForm &ssa);
+
+  /// find the redundant instructions, and return how many there are
+  std::size_t run();
+
+private:
+  ssaForm &ssa;
+  controlFlowGraph &cfg;
+};
@@ -10,7 +10,7 @@ function f2
      %2 = 3
      %3 = y2 * %2
      %4 = x2 == %3
-     ifFalse %4 goto endif3
+     ifFalse %4 goto endif1
      %5 = 5
      %6 = y2 * %5
      %7 = 3
@@ -26,22 +26,22 @@ function f2
      %15 = 2
      %16 = y2 * %15
      %17 = %14 == %16
-     ifFalse %17 goto endif1
+     ifFalse %17 goto endif2
      %18 = 'o'
      writec %18
      %18 = 'k'
      writec %18
-  label endif1 :
+  label endif2 :
      %19 = 1
      %20 = 1
      %21 = %19 + %20
      %22 = y2 == %21
-     ifFalse %22 goto endif2
+     ifFalse %22 goto endif3
      %23 = 6
      %24 = x2 * %23
      writei %24
-  label endif2 :
   label endif3 :
+  label endif1 :
      return
 endfunction
 